@@ -0,0 +1,78 @@
+﻿#include "pch.h"
+#include "AbTest.h"
+#include "Statistics.h"
+
+// Below this the difference is reported as significant
+static constexpr double SignificanceLevel = 0.05;
+
+std::vector<AbSamples> RunAbTest(std::vector<std::wstring> const& labels, AbTestOptions const& options, AbWindowRunner const& runWindow)
+{
+    std::vector<AbSamples> samples;
+    for (auto&& label : labels)
+    {
+        samples.push_back({ label, {}, {} });
+    }
+
+    std::vector<size_t> order;
+    for (size_t i = 0; i < labels.size(); i++)
+    {
+        order.push_back(i);
+    }
+    for (uint32_t round = 0; round < options.Rounds; round++)
+    {
+        wprintf(L"  Round %u/%u\n", round + 1, options.Rounds);
+        for (auto&& configIndex : order)
+        {
+            auto summary = runWindow(configIndex);
+            samples[configIndex].FramesPerSecond.push_back(summary.FramesPerSecond);
+            samples[configIndex].CaptureLatencyInMs.push_back(summary.CaptureLatency.Mean / 1000.0);
+        }
+        std::reverse(order.begin(), order.end());
+    }
+    return samples;
+}
+
+static void PrintComparison(wchar_t const* metric, wchar_t const* unit, std::vector<double> const& baseline, std::vector<double> const& candidate)
+{
+    auto test = WelchTTest(baseline, candidate);
+    if (!test.has_value())
+    {
+        wprintf(L"    %-8s not enough variation to compare\n", metric);
+        return;
+    }
+    wprintf(L"    %-8s %+9.3f %-3s t=%7.2f df=%5.1f p=%.4f%s\n",
+        metric,
+        test->Difference,
+        unit,
+        test->T,
+        test->DegreesOfFreedom,
+        test->PValue,
+        test->PValue < SignificanceLevel ? L"  significant" : L"");
+}
+
+void PrintAbReport(std::vector<AbSamples> const& samples)
+{
+    if (samples.empty())
+    {
+        return;
+    }
+
+    wprintf(L"\n");
+    wprintf(L"%-32s %8s %8s %10s %8s\n", L"Configuration", L"FPS", L"sd", L"Lat (ms)", L"sd");
+    for (auto&& sample : samples)
+    {
+        auto fps = DescribeSamples(sample.FramesPerSecond);
+        auto latency = DescribeSamples(sample.CaptureLatencyInMs);
+        wprintf(L"%-32s %8.2f %8.2f %10.3f %8.3f\n", sample.Label.c_str(), fps.Mean, fps.StandardDeviation, latency.Mean, latency.StandardDeviation);
+    }
+
+    auto const& baseline = samples.front();
+    for (size_t i = 1; i < samples.size(); i++)
+    {
+        auto const& candidate = samples[i];
+        wprintf(L"\n");
+        wprintf(L"  %s vs %s:\n", candidate.Label.c_str(), baseline.Label.c_str());
+        PrintComparison(L"FPS", L"", baseline.FramesPerSecond, candidate.FramesPerSecond);
+        PrintComparison(L"Latency", L"ms", baseline.CaptureLatencyInMs, candidate.CaptureLatencyInMs);
+    }
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "CaptureStats.h"
+
+struct AbTestOptions
+{
+    // Each configuration runs for this long per round
+    uint32_t WindowInSeconds = 10;
+    uint32_t Rounds = 5;
+};
+
+// One value per window
+struct AbSamples
+{
+    std::wstring Label;
+    std::vector<double> FramesPerSecond;
+    std::vector<double> CaptureLatencyInMs;
+};
+
+// Runs one window of the given configuration and returns what it measured
+using AbWindowRunner = std::function<CaptureSummary(size_t configIndex)>;
+
+// Interleaves short windows of each configuration so slow drift, like
+// thermals or background load, affects them all alike. The order is
+// reversed every round so no configuration always follows the same one.
+std::vector<AbSamples> RunAbTest(std::vector<std::wstring> const& labels, AbTestOptions const& options, AbWindowRunner const& runWindow);
+// Compares every configuration against the first with Welch's t-test
+void PrintAbReport(std::vector<AbSamples> const& samples);
@@ -0,0 +1,110 @@
+﻿#include "pch.h"
+#include "Adapters.h"
+#include "DisplayInfo.h"
+
+namespace winrt
+{
+    using namespace Windows::Graphics::DirectX::Direct3D11;
+}
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+}
+
+std::vector<AdapterInfo> EnumerateAdapters()
+{
+    auto factory = winrt::capture<IDXGIFactory6>(CreateDXGIFactory1);
+    std::vector<AdapterInfo> adapters;
+    winrt::com_ptr<IDXGIAdapter1> adapter;
+    for (UINT index = 0; factory->EnumAdapterByGpuPreference(index, DXGI_GPU_PREFERENCE_UNSPECIFIED, winrt::guid_of<IDXGIAdapter1>(), adapter.put_void()) != DXGI_ERROR_NOT_FOUND; index++)
+    {
+        DXGI_ADAPTER_DESC1 desc = {};
+        winrt::check_hresult(adapter->GetDesc1(&desc));
+        adapters.push_back({ index, desc.AdapterLuid, desc.Description, (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0, adapter });
+        adapter = nullptr;
+    }
+    return adapters;
+}
+
+std::optional<AdapterInfo> FindAdapterByLuid(std::vector<AdapterInfo> const& adapters, LUID luid)
+{
+    for (auto&& adapter : adapters)
+    {
+        if (adapter.Luid == luid)
+        {
+            return adapter;
+        }
+    }
+    return std::nullopt;
+}
+
+winrt::com_ptr<ID3D11Device> CreateD3DDeviceOnAdapter(IDXGIAdapter1* adapter, UINT flags)
+{
+    // The driver type has to be unknown when passing an adapter
+    winrt::com_ptr<ID3D11Device> device;
+    winrt::check_hresult(D3D11CreateDevice(
+        adapter,
+        D3D_DRIVER_TYPE_UNKNOWN,
+        nullptr,
+        flags,
+        nullptr,
+        0,
+        D3D11_SDK_VERSION,
+        device.put(),
+        nullptr,
+        nullptr));
+    return device;
+}
+
+std::wstring FormatLuid(LUID luid)
+{
+    std::array<wchar_t, 32> buffer = {};
+    swprintf_s(buffer.data(), buffer.size(), L"0x%08X%08X", static_cast<uint32_t>(luid.HighPart), luid.LowPart);
+    return std::wstring(buffer.data());
+}
+
+std::optional<LUID> ParseLuidString(std::wstring const& luidString)
+{
+    try
+    {
+        size_t parsedLength = 0;
+        auto value = std::stoull(luidString, &parsedLength, 16);
+        if (parsedLength != luidString.size())
+        {
+            return std::nullopt;
+        }
+        LUID luid = {};
+        luid.LowPart = static_cast<DWORD>(value & 0xFFFFFFFF);
+        luid.HighPart = static_cast<LONG>(value >> 32);
+        return luid;
+    }
+    catch (...)
+    {
+        return std::nullopt;
+    }
+}
+
+LUID GetDeviceAdapterLuid(winrt::IDirect3DDevice const& device)
+{
+    auto dxgiDevice = util::GetDXGIInterfaceFromObject<IDXGIDevice>(device);
+    winrt::com_ptr<IDXGIAdapter> adapter;
+    winrt::check_hresult(dxgiDevice->GetAdapter(adapter.put()));
+    DXGI_ADAPTER_DESC desc = {};
+    winrt::check_hresult(adapter->GetDesc(&desc));
+    return desc.AdapterLuid;
+}
+
+std::optional<LUID> GetMonitorAdapterLuid(HMONITOR monitor)
+{
+    auto output = FindOutputForMonitor(monitor);
+    if (output == nullptr)
+    {
+        return std::nullopt;
+    }
+    winrt::com_ptr<IDXGIAdapter> adapter;
+    winrt::check_hresult(output->GetParent(winrt::guid_of<IDXGIAdapter>(), adapter.put_void()));
+    DXGI_ADAPTER_DESC desc = {};
+    winrt::check_hresult(adapter->GetDesc(&desc));
+    return desc.AdapterLuid;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+struct AdapterInfo
+{
+    // Position in DXGI_GPU_PREFERENCE_UNSPECIFIED order, used by '-adapter'
+    uint32_t Index;
+    LUID Luid;
+    std::wstring Description;
+    bool Software;
+    winrt::com_ptr<IDXGIAdapter1> Adapter;
+};
+
+std::vector<AdapterInfo> EnumerateAdapters();
+std::optional<AdapterInfo> FindAdapterByLuid(std::vector<AdapterInfo> const& adapters, LUID luid);
+winrt::com_ptr<ID3D11Device> CreateD3DDeviceOnAdapter(IDXGIAdapter1* adapter, UINT flags);
+
+std::wstring FormatLuid(LUID luid);
+// Accepts the 64-bit value printed by FormatLuid
+std::optional<LUID> ParseLuidString(std::wstring const& luidString);
+
+// The adapter the device was created on
+LUID GetDeviceAdapterLuid(winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& device);
+// The adapter driving the monitor, if DXGI knows about it
+std::optional<LUID> GetMonitorAdapterLuid(HMONITOR monitor);
+
+inline bool operator==(LUID const& left, LUID const& right)
+{
+    return left.LowPart == right.LowPart && left.HighPart == right.HighPart;
+}
+
+inline bool operator!=(LUID const& left, LUID const& right)
+{
+    return !(left == right);
+}
@@ -0,0 +1,292 @@
+﻿#include "pch.h"
+#include "Baseline.h"
+
+static FrameRecord CreateEmptyRecord()
+{
+    FrameRecord record = {};
+    record.DirtyRectCount = -1;
+    record.ContentFrameIndex = -1;
+    record.PresentLatencyInMicroseconds = -1;
+    record.QueueDepth = -1;
+    record.Vblanks = -1;
+    return record;
+}
+
+// Names match the CSV header and the JSON keys BufferedFileSink writes.
+// Unknown names are ignored so newer files still load.
+static void SetRecordField(FrameRecord& record, std::string const& name, std::string const& value)
+{
+    auto asInt = [&]() { return std::strtoll(value.c_str(), nullptr, 10); };
+    auto asBool = [&]() { return value == "1" || value == "true"; };
+    if (name == "run") { record.RunId = static_cast<uint32_t>(asInt()); }
+    else if (name == "session") { record.SessionIndex = static_cast<uint32_t>(asInt()); }
+    else if (name == "frame") { record.FrameIndex = std::strtoull(value.c_str(), nullptr, 10); }
+    else if (name == "system_relative_time") { record.SystemRelativeTime = asInt(); }
+    else if (name == "arrival_qpc") { record.ArrivalQpc = asInt(); }
+    else if (name == "close_qpc") { record.CloseQpc = asInt(); }
+    else if (name == "hold_us") { record.HoldTimeInMicroseconds = asInt(); }
+    else if (name == "latency_us") { record.CaptureLatencyInMicroseconds = asInt(); }
+    else if (name == "content_width") { record.ContentWidth = static_cast<int32_t>(asInt()); }
+    else if (name == "content_height") { record.ContentHeight = static_cast<int32_t>(asInt()); }
+    else if (name == "surface") { record.Surface = std::strtoull(value.c_str(), nullptr, 0); }
+    else if (name == "surface_reused") { record.SurfaceReused = asBool(); }
+    else if (name == "overwritten") { record.Overwritten = asBool(); }
+    else if (name == "dirty_rects") { record.DirtyRectCount = static_cast<int32_t>(asInt()); }
+    else if (name == "dirty_fraction") { record.DirtyAreaFraction = std::strtod(value.c_str(), nullptr); }
+    else if (name == "content_frame") { record.ContentFrameIndex = asInt(); }
+    else if (name == "present_latency_us") { record.PresentLatencyInMicroseconds = asInt(); }
+    else if (name == "queue_depth") { record.QueueDepth = static_cast<int32_t>(asInt()); }
+    else if (name == "queue_dropped") { record.QueueDropped = asBool(); }
+    else if (name == "vblanks") { record.Vblanks = static_cast<int32_t>(asInt()); }
+    else if (name == "vblank_error") { record.VblankError = std::strtod(value.c_str(), nullptr); }
+}
+
+static std::vector<std::string> SplitCsvLine(std::string const& line)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ','))
+    {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+// Only handles the flat objects BufferedFileSink writes
+static std::optional<FrameRecord> ParseJsonRecord(std::string const& line)
+{
+    auto record = CreateEmptyRecord();
+    size_t position = line.find('{');
+    if (position == std::string::npos)
+    {
+        return std::nullopt;
+    }
+    position++;
+    while (true)
+    {
+        auto keyStart = line.find('"', position);
+        if (keyStart == std::string::npos)
+        {
+            break;
+        }
+        auto keyEnd = line.find('"', keyStart + 1);
+        auto colon = keyEnd == std::string::npos ? std::string::npos : line.find(':', keyEnd);
+        if (colon == std::string::npos)
+        {
+            return std::nullopt;
+        }
+        auto key = line.substr(keyStart + 1, keyEnd - keyStart - 1);
+        auto valueStart = line.find_first_not_of(' ', colon + 1);
+        if (valueStart == std::string::npos)
+        {
+            return std::nullopt;
+        }
+        size_t valueEnd = 0;
+        std::string value;
+        if (line[valueStart] == '"')
+        {
+            valueEnd = line.find('"', valueStart + 1);
+            if (valueEnd == std::string::npos)
+            {
+                return std::nullopt;
+            }
+            value = line.substr(valueStart + 1, valueEnd - valueStart - 1);
+            valueEnd++;
+        }
+        else
+        {
+            valueEnd = line.find_first_of(",}", valueStart);
+            if (valueEnd == std::string::npos)
+            {
+                return std::nullopt;
+            }
+            value = line.substr(valueStart, valueEnd - valueStart);
+        }
+        SetRecordField(record, key, value);
+        position = valueEnd;
+    }
+    return record;
+}
+
+std::optional<std::vector<FrameRecord>> LoadFrameRecords(std::wstring const& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file.is_open())
+    {
+        return std::nullopt;
+    }
+    auto extensionStart = path.find_last_of(L'.');
+    auto extension = extensionStart != std::wstring::npos ? path.substr(extensionStart) : L"";
+    std::transform(extension.begin(), extension.end(), extension.begin(), towlower);
+    auto csv = extension == L".csv";
+    if (!csv && extension != L".jsonl" && extension != L".json")
+    {
+        return std::nullopt;
+    }
+
+    std::vector<FrameRecord> records;
+    std::vector<std::string> columns;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+        if (!csv)
+        {
+            auto record = ParseJsonRecord(line);
+            if (!record.has_value())
+            {
+                return std::nullopt;
+            }
+            records.push_back(record.value());
+        }
+        else if (columns.empty())
+        {
+            columns = SplitCsvLine(line);
+        }
+        else
+        {
+            auto fields = SplitCsvLine(line);
+            if (fields.size() != columns.size())
+            {
+                return std::nullopt;
+            }
+            auto record = CreateEmptyRecord();
+            for (size_t i = 0; i < fields.size(); i++)
+            {
+                SetRecordField(record, columns[i], fields[i]);
+            }
+            records.push_back(record);
+        }
+    }
+    return std::optional(std::move(records));
+}
+
+// What each metric is computed from, in milliseconds
+struct FrameSamples
+{
+    std::vector<double> FrameInterval;
+    std::vector<double> CaptureLatency;
+    std::vector<double> HoldTime;
+    std::vector<double> PresentLatency;
+};
+
+static FrameSamples CollectSamples(std::vector<FrameRecord> const& records)
+{
+    FrameSamples samples;
+    // Intervals only make sense between frames of the same session
+    auto sorted = records;
+    std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b)
+        {
+            return std::tie(a.RunId, a.SessionIndex, a.FrameIndex) < std::tie(b.RunId, b.SessionIndex, b.FrameIndex);
+        });
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        auto const& record = sorted[i];
+        if (i > 0 && sorted[i - 1].RunId == record.RunId && sorted[i - 1].SessionIndex == record.SessionIndex)
+        {
+            // SystemRelativeTime is in 100ns units
+            auto interval = record.SystemRelativeTime - sorted[i - 1].SystemRelativeTime;
+            if (interval >= 0)
+            {
+                samples.FrameInterval.push_back(static_cast<double>(interval) / 10000.0);
+            }
+        }
+        samples.CaptureLatency.push_back(static_cast<double>(record.CaptureLatencyInMicroseconds) / 1000.0);
+        samples.HoldTime.push_back(static_cast<double>(record.HoldTimeInMicroseconds) / 1000.0);
+        if (record.PresentLatencyInMicroseconds >= 0)
+        {
+            samples.PresentLatency.push_back(static_cast<double>(record.PresentLatencyInMicroseconds) / 1000.0);
+        }
+    }
+    return samples;
+}
+
+static double FramesPerSecondFromIntervals(std::vector<double>& intervals)
+{
+    double sum = 0.0;
+    for (auto&& interval : intervals)
+    {
+        sum += interval;
+    }
+    return sum > 0.0 ? (1000.0 * static_cast<double>(intervals.size())) / sum : 0.0;
+}
+
+static SampleStatistic PercentileStatistic(double percentile)
+{
+    return [percentile](std::vector<double>& samples) { return SamplePercentile(samples, percentile); };
+}
+
+std::vector<MetricComparison> CompareToBaseline(std::vector<FrameRecord> const& baseline, std::vector<FrameRecord> const& current, BaselineOptions const& options)
+{
+    auto baselineSamples = CollectSamples(baseline);
+    auto currentSamples = CollectSamples(current);
+
+    std::vector<MetricComparison> comparisons;
+    auto compare = [&](wchar_t const* name, wchar_t const* unit, std::vector<double> const& baselineValues, std::vector<double> const& currentValues, SampleStatistic const& statistic, bool higherIsBetter, bool gated)
+    {
+        if (baselineValues.empty() || currentValues.empty())
+        {
+            return;
+        }
+        MetricComparison comparison = {};
+        comparison.Name = name;
+        comparison.Unit = unit;
+        auto baselineCopy = baselineValues;
+        auto currentCopy = currentValues;
+        comparison.Baseline = statistic(baselineCopy);
+        comparison.Current = statistic(currentCopy);
+        comparison.Difference = BootstrapDifference(baselineValues, currentValues, statistic, options.BootstrapIterations);
+        comparison.HigherIsBetter = higherIsBetter;
+        comparison.Gated = gated;
+
+        auto allowed = std::abs(comparison.Baseline) * options.ThresholdPercent / 100.0;
+        auto const& difference = comparison.Difference;
+        comparison.Regressed = higherIsBetter ?
+            (difference.Estimate < -allowed && difference.Upper < 0.0) :
+            (difference.Estimate > allowed && difference.Lower > 0.0);
+        comparisons.push_back(comparison);
+    };
+
+    compare(L"FPS", L"", baselineSamples.FrameInterval, currentSamples.FrameInterval, FramesPerSecondFromIntervals, true, true);
+    compare(L"Latency p50", L"ms", baselineSamples.CaptureLatency, currentSamples.CaptureLatency, PercentileStatistic(50.0), false, false);
+    compare(L"Latency p99", L"ms", baselineSamples.CaptureLatency, currentSamples.CaptureLatency, PercentileStatistic(99.0), false, true);
+    compare(L"Hold p99", L"ms", baselineSamples.HoldTime, currentSamples.HoldTime, PercentileStatistic(99.0), false, false);
+    compare(L"Present p99", L"ms", baselineSamples.PresentLatency, currentSamples.PresentLatency, PercentileStatistic(99.0), false, false);
+    return comparisons;
+}
+
+bool PrintBaselineReport(std::vector<MetricComparison> const& comparisons, BaselineOptions const& options)
+{
+    wprintf(L"\n");
+    wprintf(L"Compared to the baseline, 95%% intervals, regression threshold %.1f%%:\n", options.ThresholdPercent);
+    wprintf(L"  %-12s %10s %10s %10s %21s\n", L"Metric", L"Baseline", L"Current", L"Delta", L"Interval");
+    bool regressed = false;
+    for (auto&& comparison : comparisons)
+    {
+        auto const& difference = comparison.Difference;
+        auto relative = comparison.Baseline != 0.0 ? (100.0 * difference.Estimate / comparison.Baseline) : 0.0;
+        wprintf(L"  %-12s %10.3f %10.3f %+9.1f%% [%+9.3f, %+9.3f] %-2s%s\n",
+            comparison.Name.c_str(),
+            comparison.Baseline,
+            comparison.Current,
+            relative,
+            difference.Lower,
+            difference.Upper,
+            comparison.Unit.c_str(),
+            comparison.Regressed ? (comparison.Gated ? L"  REGRESSED" : L"  worse") : L"");
+        regressed |= comparison.Regressed && comparison.Gated;
+    }
+    if (comparisons.empty())
+    {
+        wprintf(L"  Not enough frames in one of the runs to compare.\n");
+    }
+    return regressed;
+}
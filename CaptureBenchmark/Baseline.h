@@ -0,0 +1,38 @@
+﻿#pragma once
+#include "ResultsSink.h"
+#include "Statistics.h"
+
+struct BaselineOptions
+{
+    // How much worse than the baseline, in percent, a gated metric can get
+    // before the run counts as a regression
+    double ThresholdPercent = 5.0;
+    uint32_t BootstrapIterations = 1000;
+};
+
+// Reads the records a BufferedFileSink wrote, from a .csv or .jsonl file.
+// Columns missing from older files keep the value that means unreported.
+std::optional<std::vector<FrameRecord>> LoadFrameRecords(std::wstring const& path);
+
+struct MetricComparison
+{
+    std::wstring Name;
+    std::wstring Unit;
+    double Baseline;
+    double Current;
+    // Current minus baseline
+    ConfidenceInterval Difference;
+    bool HigherIsBetter;
+    // Only gated metrics fail the comparison
+    bool Gated;
+    // Worse by more than the threshold, with the whole interval on the
+    // worse side of zero
+    bool Regressed;
+};
+
+// Per-frame samples from both runs, bootstrapped for each metric. Frame
+// intervals come from SystemRelativeTime, so runs from different machines
+// can be compared.
+std::vector<MetricComparison> CompareToBaseline(std::vector<FrameRecord> const& baseline, std::vector<FrameRecord> const& current, BaselineOptions const& options);
+// Returns true if a gated metric regressed
+bool PrintBaselineReport(std::vector<MetricComparison> const& comparisons, BaselineOptions const& options);
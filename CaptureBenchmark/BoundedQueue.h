@@ -0,0 +1,113 @@
+﻿#pragma once
+
+// A bounded lock-free queue, after Dmitry Vyukov's MPMC design. Each cell's
+// sequence number says whether it is ready to be written or read for a given
+// position, so producers and consumers only contend on the position counters.
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity) : m_capacity(capacity)
+    {
+        // The cells are a power of two so positions can be masked, the
+        // requested capacity is still what TryPush enforces
+        size_t cellCount = 1;
+        while (cellCount < capacity)
+        {
+            cellCount <<= 1;
+        }
+        m_cells = std::make_unique<Cell[]>(cellCount);
+        m_mask = cellCount - 1;
+        for (size_t i = 0; i < cellCount; i++)
+        {
+            m_cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    BoundedQueue(BoundedQueue const&) = delete;
+    BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+    // Leaves value alone and returns false when the queue is full
+    bool TryPush(T& value)
+    {
+        auto position = m_enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            if (position - m_dequeuePosition.load(std::memory_order_acquire) >= m_capacity)
+            {
+                return false;
+            }
+            auto& cell = m_cells[position & m_mask];
+            auto sequence = cell.Sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.Value = std::move(value);
+                    cell.Sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // A consumer hasn't finished with the cell yet
+                return false;
+            }
+            else
+            {
+                position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& value)
+    {
+        auto position = m_dequeuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& cell = m_cells[position & m_mask];
+            auto sequence = cell.Sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0)
+            {
+                if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.Value);
+                    cell.Sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only a snapshot while other threads are pushing or popping
+    size_t Size() const
+    {
+        auto dequeuePosition = m_dequeuePosition.load(std::memory_order_acquire);
+        auto enqueuePosition = m_enqueuePosition.load(std::memory_order_acquire);
+        return enqueuePosition > dequeuePosition ? enqueuePosition - dequeuePosition : 0;
+    }
+    size_t Capacity() const { return m_capacity; }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> Sequence;
+        T Value;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    size_t m_capacity = 0;
+    // Kept on separate cache lines so producers and consumers don't share one
+    alignas(64) std::atomic<size_t> m_enqueuePosition{ 0 };
+    alignas(64) std::atomic<size_t> m_dequeuePosition{ 0 };
+};
@@ -0,0 +1,129 @@
+﻿#include "pch.h"
+#include "CaptureBenchmark.h"
+#include "Adapters.h"
+#include "UtilizationSampler.h"
+
+namespace winrt
+{
+    using namespace Windows::Graphics::DirectX::Direct3D11;
+}
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+}
+
+winrt::IDirect3DDevice CreateCaptureDevice(CaptureConfig const& config)
+{
+    UINT deviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+    if (config.Workload == WorkloadKind::Encode || config.Workload == WorkloadKind::Pipeline)
+    {
+        deviceFlags |= D3D11_CREATE_DEVICE_VIDEO_SUPPORT;
+    }
+    winrt::com_ptr<ID3D11Device> d3dDevice;
+    if (config.AdapterIndex.has_value())
+    {
+        auto adapters = EnumerateAdapters();
+        auto index = config.AdapterIndex.value();
+        if (index >= adapters.size())
+        {
+            throw winrt::hresult_invalid_argument(L"The adapter is no longer available.");
+        }
+        d3dDevice = CreateD3DDeviceOnAdapter(adapters[index].Adapter.get(), deviceFlags);
+    }
+    else
+    {
+        d3dDevice = util::CreateD3DDevice(deviceFlags);
+    }
+    if (config.Workload != WorkloadKind::None || config.GeneratedContent)
+    {
+        // Workloads and the frame counter reader use the immediate context
+        // from the capture threads
+        auto multithread = d3dDevice.as<ID3D10Multithread>();
+        multithread->SetMultithreadProtected(TRUE);
+    }
+    auto dxgiDevice = d3dDevice.as<IDXGIDevice>();
+    return CreateDirect3DDevice(dxgiDevice.get());
+}
+
+void CaptureBenchmark::Configure(
+    std::vector<CaptureItemSource> const& sources,
+    CaptureConfig const& config,
+    RunOptions const& runOptions,
+    std::vector<std::shared_ptr<ResultsSink>> const& sinks,
+    winrt::IDirect3DDevice const& device)
+{
+    if (sources.empty())
+    {
+        throw winrt::hresult_invalid_argument(L"There is nothing to capture.");
+    }
+    m_sources = sources;
+    m_config = config;
+    m_runOptions = runOptions;
+    m_sinks = sinks;
+    m_device = device != nullptr ? device : CreateCaptureDevice(config);
+    m_configured = true;
+    m_stopEvent.ResetEvent();
+}
+
+void CaptureBenchmark::Run()
+{
+    if (!m_configured)
+    {
+        throw winrt::hresult_error(E_ILLEGAL_METHOD_CALL, L"Configure has to be called before Run.");
+    }
+
+    m_results = {};
+    std::vector<std::unique_ptr<CaptureRunner>> runners;
+    for (auto&& source : m_sources)
+    {
+        auto sessionConfig = m_config;
+        sessionConfig.SessionIndex = static_cast<uint32_t>(runners.size());
+        runners.push_back(std::make_unique<CaptureRunner>(m_device, source, sessionConfig, m_sinks));
+    }
+    for (auto&& runner : runners)
+    {
+        runner->Start();
+    }
+
+    UtilizationSampler sampler;
+    auto stopped = false;
+    if (m_runOptions.WarmupInSeconds > 0)
+    {
+        stopped = m_stopEvent.wait(m_runOptions.WarmupInSeconds * 1000);
+        for (auto&& runner : runners)
+        {
+            runner->ResetStats();
+        }
+    }
+    sampler.Start();
+    if (!stopped)
+    {
+        m_stopEvent.wait(m_runOptions.DurationInSeconds.has_value() ? m_runOptions.DurationInSeconds.value() * 1000 : INFINITE);
+    }
+    auto utilization = sampler.Stop();
+
+    for (auto&& runner : runners)
+    {
+        runner->Stop();
+    }
+
+    CaptureStats aggregate;
+    for (auto&& runner : runners)
+    {
+        m_results.Sessions.push_back({ runner->DisplayName(), runner->Summarize() });
+        aggregate.Add(runner->Stats());
+    }
+    m_results.Aggregate = aggregate.Summarize();
+    // The sampling covers every session, so it only describes the aggregate
+    m_results.Aggregate.Utilization = utilization;
+    if (m_results.Sessions.size() == 1)
+    {
+        m_results.Sessions.front().Summary.Utilization = utilization;
+    }
+}
+
+void CaptureBenchmark::Stop()
+{
+    m_stopEvent.SetEvent();
+}
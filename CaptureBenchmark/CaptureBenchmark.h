@@ -0,0 +1,54 @@
+﻿#pragma once
+#include "CaptureItemSource.h"
+#include "CaptureRunner.h"
+#include "CaptureStats.h"
+#include "ResultsSink.h"
+
+struct RunOptions
+{
+    uint32_t WarmupInSeconds;
+    // Run until CaptureBenchmark::Stop when unset
+    std::optional<uint32_t> DurationInSeconds;
+    std::optional<double> MinimumFramesPerSecond;
+};
+
+// On the configured adapter, with what the configured workload needs
+winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice CreateCaptureDevice(CaptureConfig const& config);
+
+// Measures one configuration across one or more sources captured at the
+// same time, with a session and thread per source. Configure, Run, then read
+// the Results. This is all the frontend does for a plain run, and can be
+// embedded anywhere the same numbers are needed.
+class CaptureBenchmark
+{
+public:
+    CaptureBenchmark() = default;
+    CaptureBenchmark(CaptureBenchmark const&) = delete;
+    CaptureBenchmark& operator=(CaptureBenchmark const&) = delete;
+
+    // A device is created for the configuration unless one is passed in
+    void Configure(
+        std::vector<CaptureItemSource> const& sources,
+        CaptureConfig const& config,
+        RunOptions const& runOptions,
+        std::vector<std::shared_ptr<ResultsSink>> const& sinks = {},
+        winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& device = nullptr);
+    // Blocks through the warmup and the measured duration, or until Stop
+    void Run();
+    // Ends the run early, can be called from any thread. Stays set until
+    // the next Configure.
+    void Stop();
+
+    // Available after Run
+    MultiCaptureSummary const& Results() const { return m_results; }
+
+private:
+    std::vector<CaptureItemSource> m_sources;
+    CaptureConfig m_config;
+    RunOptions m_runOptions = {};
+    std::vector<std::shared_ptr<ResultsSink>> m_sinks;
+    winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device{ nullptr };
+    bool m_configured = false;
+    wil::slim_event_manual_reset m_stopEvent;
+    MultiCaptureSummary m_results;
+};
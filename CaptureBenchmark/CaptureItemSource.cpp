@@ -0,0 +1,40 @@
+﻿#include "pch.h"
+#include "CaptureItemSource.h"
+
+namespace winrt
+{
+    using namespace Windows::Graphics::Capture;
+}
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+    using namespace robmikh::common::desktop;
+}
+
+winrt::GraphicsCaptureItem CreateCaptureItemFromSource(CaptureItemSource itemSource)
+{
+    return std::visit(overloaded
+        {
+            [=](MonitorCaptureItemSource const& source) -> winrt::GraphicsCaptureItem { return util::CreateCaptureItemForMonitor(source.Monitor); },
+            [=](WindowCaptureItemSource const& source) -> winrt::GraphicsCaptureItem { return util::CreateCaptureItemForWindow(source.Window); },
+        }, itemSource);
+}
+
+HMONITOR GetMonitorFromSource(CaptureItemSource itemSource)
+{
+    return std::visit(overloaded
+        {
+            [=](MonitorCaptureItemSource const& source) -> HMONITOR { return source.Monitor; },
+            [=](WindowCaptureItemSource const& source) -> HMONITOR { return MonitorFromWindow(source.Window, MONITOR_DEFAULTTONEAREST); },
+        }, itemSource);
+}
+
+std::shared_ptr<PresentHistory> GetContentPresentsFromSource(CaptureItemSource const& itemSource)
+{
+    if (auto windowSource = std::get_if<WindowCaptureItemSource>(&itemSource))
+    {
+        return windowSource->ContentPresents;
+    }
+    return nullptr;
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+
+template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
+template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+
+struct MonitorCaptureItemSource
+{
+    HMONITOR Monitor;
+};
+
+class PresentHistory;
+
+struct WindowCaptureItemSource
+{
+    HWND Window;
+    // Set when the window is a ContentGenerator, its frame counter is read
+    // back from each frame
+    std::shared_ptr<PresentHistory> ContentPresents;
+};
+
+typedef std::variant<MonitorCaptureItemSource, WindowCaptureItemSource> CaptureItemSource;
+
+winrt::Windows::Graphics::Capture::GraphicsCaptureItem CreateCaptureItemFromSource(CaptureItemSource itemSource);
+// The monitor being captured, or the one a window is mostly on
+HMONITOR GetMonitorFromSource(CaptureItemSource itemSource);
+std::shared_ptr<PresentHistory> GetContentPresentsFromSource(CaptureItemSource const& itemSource);
@@ -0,0 +1,631 @@
+﻿#include "pch.h"
+#include "CaptureRunner.h"
+#include "Adapters.h"
+#include "ContentGenerator.h"
+#include "Enumeration.h"
+#include "PixelFormat.h"
+#include "Timing.h"
+
+namespace winrt
+{
+    using namespace Windows::Foundation;
+    using namespace Windows::Graphics;
+    using namespace Windows::Graphics::Capture;
+    using namespace Windows::Graphics::DirectX;
+    using namespace Windows::Graphics::DirectX::Direct3D11;
+    using namespace Windows::System;
+}
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+}
+
+CaptureRunner::CaptureRunner(
+    winrt::IDirect3DDevice const& device,
+    CaptureItemSource const& source,
+    CaptureConfig const& config,
+    std::vector<std::shared_ptr<ResultsSink>> const& sinks) : m_device(device), m_source(source), m_config(config), m_sinks(sinks)
+{
+    if (m_config.BufferCount == 0)
+    {
+        throw winrt::hresult_invalid_argument(L"The frame pool needs at least one buffer.");
+    }
+    m_controller = winrt::DispatcherQueueController::CreateOnDedicatedThread();
+    m_queue = m_controller.DispatcherQueue();
+}
+
+CaptureRunner::~CaptureRunner()
+{
+    try
+    {
+        Stop();
+    }
+    catch (...)
+    {
+    }
+}
+
+void CaptureRunner::Start()
+{
+    if (m_started)
+    {
+        throw winrt::hresult_error(E_ILLEGAL_METHOD_CALL);
+    }
+    m_started = true;
+
+    RunOnCaptureThread([&]()
+        {
+            m_startQpc = GetQpcNow();
+            auto stepQpc = m_startQpc;
+            auto lap = [&stepQpc]()
+            {
+                auto nowQpc = GetQpcNow();
+                auto elapsedQpc = nowQpc - stepQpc;
+                stepQpc = nowQpc;
+                return elapsedQpc;
+            };
+
+            auto item = CreateCaptureItemFromSource(m_source);
+            m_startupTimings.CreateItemQpc = lap();
+            m_displayName = item.DisplayName();
+            // The DWM composes on the monitor's adapter, anything else
+            // means every frame gets copied between GPUs. Cached per monitor,
+            // and from the enumeration snapshot if one was taken.
+            auto monitorDetails = GetMonitorDetails(GetMonitorFromSource(m_source));
+            auto const& monitorAdapterLuid = monitorDetails.AdapterLuid;
+            m_stats.SetCrossAdapter(monitorAdapterLuid.has_value() && monitorAdapterLuid.value() != GetDeviceAdapterLuid(m_device));
+            if (monitorDetails.Mode.has_value())
+            {
+                m_stats.SetSignalRefreshRate(monitorDetails.Mode->SignalRefreshRate);
+            }
+            if (monitorDetails.Capabilities.has_value())
+            {
+                m_stats.SetOutputCapabilities(monitorDetails.Capabilities.value());
+            }
+            lap();
+            if (m_config.FreeThreaded)
+            {
+                m_framePool = winrt::Direct3D11CaptureFramePool::CreateFreeThreaded(
+                    m_device,
+                    m_config.PixelFormat,
+                    m_config.BufferCount,
+                    item.Size());
+            }
+            else
+            {
+                m_framePool = winrt::Direct3D11CaptureFramePool::Create(
+                    m_device,
+                    m_config.PixelFormat,
+                    m_config.BufferCount,
+                    item.Size());
+            }
+            m_startupTimings.CreateFramePoolQpc = lap();
+            if (m_config.WorkerCount > 0)
+            {
+                for (uint32_t workerIndex = 0; workerIndex < m_config.WorkerCount; workerIndex++)
+                {
+                    auto workload = CreateFrameWorkload(
+                        m_config.Workload,
+                        util::GetDXGIInterfaceFromObject<ID3D11Device>(m_device),
+                        GetEncodeOutputPath(workerIndex),
+                        m_config.Pipeline);
+                    if (workload != nullptr)
+                    {
+                        workload->Prepare(item.Size(), GetDxgiFormat(m_config.PixelFormat));
+                    }
+                    m_workerWorkloads.push_back(std::move(workload));
+                }
+                auto queueDepth = m_config.QueueDepth > 0 ? m_config.QueueDepth : m_config.BufferCount;
+                m_workerPool = std::make_unique<FrameWorkerPool>(
+                    m_config.WorkerCount,
+                    queueDepth,
+                    [this](auto workerIndex, auto& frame) { OnWorkerFrame(workerIndex, frame); });
+            }
+            else
+            {
+                m_workload = CreateFrameWorkload(
+                    m_config.Workload,
+                    util::GetDXGIInterfaceFromObject<ID3D11Device>(m_device),
+                    GetEncodeOutputPath(),
+                    m_config.Pipeline);
+                if (m_workload != nullptr)
+                {
+                    m_workload->Prepare(item.Size(), GetDxgiFormat(m_config.PixelFormat));
+                }
+            }
+            m_contentPresents = GetContentPresentsFromSource(m_source);
+            if (m_contentPresents != nullptr)
+            {
+                m_counterReader = std::make_unique<FrameCounterReader>(
+                    util::GetDXGIInterfaceFromObject<ID3D11Device>(m_device),
+                    GetDxgiFormat(m_config.PixelFormat));
+            }
+            m_poolSize = item.Size();
+            m_stats.SetPoolBytes(GetPoolBytes(m_poolSize));
+            lap();
+            m_session = m_framePool.CreateCaptureSession(item);
+            m_startupTimings.CreateSessionQpc = lap();
+            m_frameArrived = m_framePool.FrameArrived(winrt::auto_revoke, { this, &CaptureRunner::OnFrameArrived });
+            m_session.IsCursorCaptureEnabled(m_config.CursorCapture);
+            if (m_config.NoBorder)
+            {
+                m_session.IsBorderRequired(false);
+            }
+            if (m_config.DirtyRegions)
+            {
+                // Frames are still complete, we only want the regions reported
+                m_session.DirtyRegionMode(winrt::GraphicsCaptureDirtyRegionMode::ReportOnly);
+            }
+
+            if (m_config.Throttle == ThrottleMode::MinUpdateInterval)
+            {
+                m_session.MinUpdateInterval(std::chrono::milliseconds(m_config.IntervalInMs));
+            }
+            else if (m_workerPool == nullptr)
+            {
+                m_scheduler = CreateReleaseScheduler(
+                    m_config.Scheduler,
+                    std::chrono::milliseconds(m_config.IntervalInMs),
+                    m_queue,
+                    GetMonitorFromSource(m_source));
+                m_scheduler->Start([this](auto scheduledQpc, auto actualQpc) { OnRelease(scheduledQpc, actualQpc); });
+            }
+
+            // Prefer the captured monitor's own refresh rate, the DWM's
+            // timing is for the primary monitor
+            auto const& refreshRate = monitorDetails.RefreshRate;
+            if (refreshRate.has_value())
+            {
+                m_refreshPeriod = std::llround(HundredNanosecondsPerSecond / refreshRate.value());
+            }
+            else
+            {
+                DWM_TIMING_INFO timingInfo = {};
+                timingInfo.cbSize = sizeof(timingInfo);
+                if (SUCCEEDED(DwmGetCompositionTimingInfo(nullptr, &timingInfo)))
+                {
+                    m_refreshPeriod = QpcToHundredNanoseconds(static_cast<int64_t>(timingInfo.qpcRefreshPeriod));
+                }
+            }
+            if (m_refreshPeriod > 0)
+            {
+                m_stats.SetRefreshRate(static_cast<double>(HundredNanosecondsPerSecond) / static_cast<double>(m_refreshPeriod));
+            }
+
+            m_stats.Start(GetQpcNow());
+            lap();
+            m_session.StartCapture();
+            m_startupTimings.StartCaptureQpc = lap();
+        });
+}
+
+void CaptureRunner::Stop()
+{
+    if (!m_started || m_stopped)
+    {
+        return;
+    }
+    m_stopped = true;
+
+    RunOnCaptureThread([&]()
+        {
+            // Start may have failed part way through
+            if (m_scheduler != nullptr)
+            {
+                m_scheduler->Stop();
+                if (m_scheduler->Error() != S_OK)
+                {
+                    m_stats.SetSchedulerError(m_scheduler->Error());
+                }
+            }
+            m_frameArrived.revoke();
+            {
+                std::scoped_lock lock(m_heldFrameLock);
+                m_closed = true;
+                m_stats.Stop(GetQpcNow());
+                if (m_heldFrame != nullptr)
+                {
+                    m_heldFrame.Close();
+                    m_heldFrame = nullptr;
+                }
+            }
+            // Nothing is enqueued once m_closed is set
+            if (m_workerPool != nullptr)
+            {
+                m_workerPool->Stop([](auto& frame) { frame.Frame.Close(); });
+                for (auto&& workload : m_workerWorkloads)
+                {
+                    if (workload != nullptr)
+                    {
+                        workload->Finish();
+                    }
+                }
+            }
+            if (m_framePool != nullptr)
+            {
+                m_framePool.Close();
+            }
+            if (m_session != nullptr)
+            {
+                m_session.Close();
+            }
+            std::scoped_lock workloadLock(m_workloadLock);
+            if (m_workload != nullptr)
+            {
+                m_workload->Finish();
+            }
+        });
+    m_controller.ShutdownQueueAsync().get();
+
+    for (auto&& sink : m_sinks)
+    {
+        sink->Flush();
+    }
+}
+
+StartupTimings CaptureRunner::GetStartupTimings() const
+{
+    auto timings = m_startupTimings;
+    timings.FirstFrameQpc = m_firstFrameQpc.load();
+    return timings;
+}
+
+bool CaptureRunner::WaitForFirstFrame(std::chrono::milliseconds timeout)
+{
+    return m_firstFrameEvent.wait(static_cast<DWORD>(timeout.count()));
+}
+
+void CaptureRunner::ResetStats()
+{
+    // Serialize with the frame handlers so no sample straddles the reset
+    RunOnCaptureThread([&]()
+        {
+            std::scoped_lock lock(m_heldFrameLock);
+            m_stats.Start(GetQpcNow());
+        });
+}
+
+void CaptureRunner::SetReleaseInterval(std::chrono::milliseconds interval)
+{
+    RunOnCaptureThread([&]()
+        {
+            m_config.IntervalInMs = static_cast<uint32_t>(interval.count());
+            if (m_config.Throttle == ThrottleMode::MinUpdateInterval)
+            {
+                m_session.MinUpdateInterval(interval);
+            }
+            else if (m_scheduler != nullptr)
+            {
+                m_scheduler->SetInterval(interval);
+            }
+        });
+}
+
+uint64_t CaptureRunner::GetPoolBytes(winrt::SizeInt32 size) const
+{
+    // Ignores any padding the driver adds
+    auto frameBytes = static_cast<uint64_t>(size.Width) * static_cast<uint64_t>(size.Height) * GetBytesPerPixel(m_config.PixelFormat);
+    return frameBytes * m_config.BufferCount;
+}
+
+std::wstring CaptureRunner::GetEncodeOutputPath(uint32_t workerIndex) const
+{
+    // Concurrent sessions, matrix runs and workers each get their own file
+    auto path = m_config.EncodeOutputPath;
+    std::wstring suffix;
+    if (m_config.RunId != 0 || m_config.SessionIndex != 0)
+    {
+        suffix = L"-r" + std::to_wstring(m_config.RunId) + L"-s" + std::to_wstring(m_config.SessionIndex);
+    }
+    if (m_config.WorkerCount > 1)
+    {
+        suffix += L"-w" + std::to_wstring(workerIndex);
+    }
+    if (suffix.empty())
+    {
+        return path;
+    }
+    auto extension = path.find_last_of(L'.');
+    auto separator = path.find_last_of(L"\\/");
+    if (extension == std::wstring::npos || (separator != std::wstring::npos && extension < separator))
+    {
+        return path + suffix;
+    }
+    return path.insert(extension, suffix);
+}
+
+void CaptureRunner::RunOnCaptureThread(std::function<void()> const& work)
+{
+    // Exceptions would otherwise be lost on the capture thread and leave
+    // us waiting forever
+    std::exception_ptr exception;
+    wil::shared_event event(wil::EventOptions::None);
+    auto enqueued = m_queue.TryEnqueue([&work, &exception, event]()
+        {
+            try
+            {
+                work();
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+            event.SetEvent();
+        });
+    if (!enqueued)
+    {
+        throw winrt::hresult_error(E_ABORT, L"Could not enqueue work to the capture thread.");
+    }
+    event.wait();
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+void CaptureRunner::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& sender, winrt::IInspectable const&)
+{
+    auto arrivalQpc = GetQpcNow();
+    int64_t noFrameYet = 0;
+    if (m_firstFrameQpc.compare_exchange_strong(noFrameYet, arrivalQpc - m_startQpc))
+    {
+        m_firstFrameEvent.SetEvent();
+    }
+    winrt::Direct3D11CaptureFrame frame{ nullptr };
+    {
+        std::scoped_lock lock(m_heldFrameLock);
+        if (m_closed)
+        {
+            return;
+        }
+        frame = sender.TryGetNextFrame();
+        if (frame == nullptr)
+        {
+            return;
+        }
+    }
+    auto systemRelativeTime = frame.SystemRelativeTime().count();
+    auto contentSize = frame.ContentSize();
+    auto texture = util::GetDXGIInterfaceFromObject<ID3D11Texture2D>(frame.Surface());
+
+    int32_t dirtyRectCount = -1;
+    double dirtyAreaFraction = 0.0;
+    if (m_config.DirtyRegions)
+    {
+        auto dirtyRegions = frame.DirtyRegions();
+        int64_t dirtyPixels = 0;
+        for (auto&& rect : dirtyRegions)
+        {
+            // Only count what falls inside the content
+            auto left = std::max(rect.X, 0);
+            auto top = std::max(rect.Y, 0);
+            auto right = std::min(rect.X + rect.Width, contentSize.Width);
+            auto bottom = std::min(rect.Y + rect.Height, contentSize.Height);
+            if (right > left && bottom > top)
+            {
+                dirtyPixels += static_cast<int64_t>(right - left) * (bottom - top);
+            }
+        }
+        auto contentPixels = static_cast<int64_t>(contentSize.Width) * contentSize.Height;
+        // The rects don't overlap, but be safe
+        dirtyPixels = std::min(dirtyPixels, contentPixels);
+        dirtyRectCount = static_cast<int32_t>(dirtyRegions.Size());
+        if (contentPixels > 0)
+        {
+            dirtyAreaFraction = static_cast<double>(dirtyPixels) / static_cast<double>(contentPixels);
+        }
+        m_stats.RecordDirtyRegions(dirtyRegions.Size(), dirtyPixels, contentPixels);
+    }
+
+    // The counter and workload run outside the held frame lock, the
+    // release of the previous frame shouldn't have to wait on them
+    int64_t contentFrameIndex = -1;
+    int64_t presentLatencyInMicroseconds = -1;
+    if (m_counterReader != nullptr)
+    {
+        std::scoped_lock workloadLock(m_workloadLock);
+        auto counter = m_counterReader->Read(texture.get(), contentSize);
+        if (counter.has_value())
+        {
+            contentFrameIndex = counter.value();
+            if (m_lastContentCounter.has_value())
+            {
+                // Unsigned, so a wrapped counter still gives the right gap
+                m_stats.RecordContentCounterGap(static_cast<uint32_t>(counter.value() - m_lastContentCounter.value()));
+            }
+            m_lastContentCounter = counter;
+            if (auto presentQpc = m_contentPresents->Find(counter.value()))
+            {
+                presentLatencyInMicroseconds = QpcToMicroseconds(arrivalQpc - presentQpc.value());
+                m_stats.RecordPresentLatency(arrivalQpc - presentQpc.value());
+            }
+        }
+        else
+        {
+            m_stats.RecordContentDecodeFailure();
+        }
+    }
+    if (m_workload != nullptr)
+    {
+        std::scoped_lock workloadLock(m_workloadLock);
+        auto workloadStartQpc = GetQpcNow();
+        auto result = m_workload->Process({ texture.get(), contentSize, systemRelativeTime });
+        m_stats.RecordWorkload(systemRelativeTime, workloadStartQpc, GetQpcNow(), result);
+    }
+
+    std::scoped_lock lock(m_heldFrameLock);
+    if (m_closed)
+    {
+        frame.Close();
+        return;
+    }
+    m_stats.RecordFrameArrived(systemRelativeTime, arrivalQpc);
+    m_stats.RecordFrameBytes(static_cast<uint64_t>(contentSize.Width) * static_cast<uint64_t>(contentSize.Height) * GetBytesPerPixel(m_config.PixelFormat));
+    int32_t vblanks = -1;
+    double vblankError = 0.0;
+    if (m_refreshPeriod > 0 && m_lastSystemRelativeTime != 0)
+    {
+        auto gap = systemRelativeTime - m_lastSystemRelativeTime;
+        auto vblankCount = (gap + (m_refreshPeriod / 2)) / m_refreshPeriod;
+        // Near zero on a fixed refresh monitor, compositions happen on vblanks
+        auto alignmentError = std::abs(gap - (vblankCount * m_refreshPeriod));
+        m_stats.RecordVblankInterval(vblankCount, (alignmentError * 10000) / m_refreshPeriod);
+        vblanks = static_cast<int32_t>(vblankCount);
+        vblankError = static_cast<double>(alignmentError) / static_cast<double>(m_refreshPeriod);
+    }
+    m_lastSystemRelativeTime = systemRelativeTime;
+    if (m_config.RecreateOnResize)
+    {
+        TrackContentSize(contentSize, texture.get(), arrivalQpc);
+    }
+
+    auto surface = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(texture.get()));
+    auto surfaceReused = !m_seenSurfaces.insert(surface).second;
+
+    FrameRecord record = {};
+    record.RunId = m_config.RunId;
+    record.SessionIndex = m_config.SessionIndex;
+    record.FrameIndex = m_nextFrameIndex++;
+    record.SystemRelativeTime = systemRelativeTime;
+    record.ArrivalQpc = arrivalQpc;
+    record.CaptureLatencyInMicroseconds = (QpcToHundredNanoseconds(arrivalQpc) - systemRelativeTime) / 10;
+    record.ContentWidth = contentSize.Width;
+    record.ContentHeight = contentSize.Height;
+    record.Surface = surface;
+    record.SurfaceReused = surfaceReused;
+    record.DirtyRectCount = dirtyRectCount;
+    record.DirtyAreaFraction = dirtyAreaFraction;
+    record.ContentFrameIndex = contentFrameIndex;
+    record.PresentLatencyInMicroseconds = presentLatencyInMicroseconds;
+    record.QueueDepth = -1;
+    record.Vblanks = vblanks;
+    record.VblankError = vblankError;
+
+    if (m_workerPool != nullptr)
+    {
+        auto depth = m_workerPool->Depth();
+        m_stats.RecordQueueDepth(depth);
+        record.QueueDepth = static_cast<int32_t>(depth);
+        QueuedFrame queued = { frame, texture, record, GetQpcNow() };
+        if (!m_workerPool->TryEnqueue(queued))
+        {
+            // No slot for it, the consumer would have to drop it. Nothing
+            // overwrote it, so it isn't counted as overwritten.
+            m_stats.RecordQueueDrop();
+            record.QueueDropped = true;
+            CloseFrame(frame, record, false);
+        }
+        return;
+    }
+
+    // With more than one buffer we can get a new frame before
+    // the timer released the last one.
+    if (m_heldFrame != nullptr)
+    {
+        CloseHeldFrame(true);
+    }
+    m_heldFrame = frame;
+    m_heldFrameRecord = record;
+
+    // Nothing holds the frame when the session does the throttling
+    if (m_config.Throttle == ThrottleMode::MinUpdateInterval)
+    {
+        CloseHeldFrame(false);
+    }
+}
+
+void CaptureRunner::TrackContentSize(winrt::SizeInt32 contentSize, ID3D11Texture2D* texture, int64_t arrivalQpc)
+{
+    if (m_recreatePending)
+    {
+        // Frames already in flight still use the old buffers
+        D3D11_TEXTURE2D_DESC desc = {};
+        texture->GetDesc(&desc);
+        if (static_cast<int32_t>(desc.Width) == m_poolSize.Width && static_cast<int32_t>(desc.Height) == m_poolSize.Height)
+        {
+            m_stats.RecordResize(arrivalQpc - m_lastOldSizeArrivalQpc);
+            m_recreatePending = false;
+        }
+    }
+
+    // Minimized windows report an empty content size
+    auto sizeChanged = contentSize.Width != m_poolSize.Width || contentSize.Height != m_poolSize.Height;
+    if (sizeChanged && contentSize.Width > 0 && contentSize.Height > 0)
+    {
+        if (!m_recreatePending)
+        {
+            // A resize on the very first frame is measured from that frame
+            m_lastOldSizeArrivalQpc = m_lastArrivalQpc != 0 ? m_lastArrivalQpc : arrivalQpc;
+        }
+        m_framePool.Recreate(
+            m_device,
+            m_config.PixelFormat,
+            m_config.BufferCount,
+            contentSize);
+        m_poolSize = contentSize;
+        m_stats.SetPoolBytes(GetPoolBytes(m_poolSize));
+        m_recreatePending = true;
+        m_stats.RecordRecreate();
+    }
+    m_lastArrivalQpc = arrivalQpc;
+}
+
+void CaptureRunner::OnRelease(int64_t scheduledQpc, int64_t actualQpc)
+{
+    std::scoped_lock lock(m_heldFrameLock);
+    if (m_closed)
+    {
+        return;
+    }
+    m_stats.RecordRelease(scheduledQpc, actualQpc);
+    if (m_heldFrame != nullptr)
+    {
+        CloseHeldFrame(false);
+    }
+}
+
+void CaptureRunner::OnWorkerFrame(uint32_t workerIndex, QueuedFrame& frame)
+{
+    m_stats.RecordQueueWait(GetQpcNow() - frame.EnqueueQpc);
+    auto& workload = m_workerWorkloads[workerIndex];
+    if (workload != nullptr)
+    {
+        auto const& record = frame.Record;
+        auto workloadStartQpc = GetQpcNow();
+        auto result = workload->Process({ frame.Texture.get(), { record.ContentWidth, record.ContentHeight }, record.SystemRelativeTime });
+        // Workers share the immediate context, so with more than one each
+        // worker's timestamp queries also bracket the others' work
+        if (m_config.WorkerCount > 1)
+        {
+            result.GpuStartQpc.reset();
+            result.GpuDurationQpc.reset();
+        }
+        m_stats.RecordWorkload(record.SystemRelativeTime, workloadStartQpc, GetQpcNow(), result);
+    }
+    CloseFrame(frame.Frame, frame.Record, false);
+}
+
+void CaptureRunner::CloseFrame(winrt::Direct3D11CaptureFrame const& frame, FrameRecord& record, bool overwritten)
+{
+    frame.Close();
+    auto closeQpc = GetQpcNow();
+    m_stats.RecordFrameClosed(record.ArrivalQpc, closeQpc, overwritten);
+
+    if (!m_sinks.empty())
+    {
+        record.CloseQpc = closeQpc;
+        record.HoldTimeInMicroseconds = QpcToMicroseconds(closeQpc - record.ArrivalQpc);
+        record.Overwritten = overwritten;
+        for (auto&& sink : m_sinks)
+        {
+            sink->Write(record);
+        }
+    }
+}
+
+void CaptureRunner::CloseHeldFrame(bool overwritten)
+{
+    CloseFrame(m_heldFrame, m_heldFrameRecord, overwritten);
+    m_heldFrame = nullptr;
+}
@@ -0,0 +1,163 @@
+﻿#pragma once
+#include "CaptureItemSource.h"
+#include "CaptureStats.h"
+#include "FrameCounterReader.h"
+#include "FrameWorkerPool.h"
+#include "FrameWorkload.h"
+#include "ReleaseScheduler.h"
+#include "ResultsSink.h"
+
+enum class ThrottleMode
+{
+    // Hold each frame until the release scheduler closes it
+    Starvation,
+    // Let GraphicsCaptureSession.MinUpdateInterval throttle and close
+    // frames as soon as they arrive
+    MinUpdateInterval,
+};
+
+struct CaptureConfig
+{
+    uint32_t IntervalInMs = 1000;
+    uint32_t BufferCount = 1;
+    // R16G16B16A16Float for HDR content
+    winrt::Windows::Graphics::DirectX::DirectXPixelFormat PixelFormat = winrt::Windows::Graphics::DirectX::DirectXPixelFormat::B8G8R8A8UIntNormalized;
+    bool NoBorder = false;
+    bool CursorCapture = false;
+    // Ask for DirtyRegions on each frame, requires a recent build
+    bool DirtyRegions = false;
+    // FrameArrived is raised on a thread pool thread instead of the dispatcher queue
+    bool FreeThreaded = false;
+    ReleaseSchedulerKind Scheduler = ReleaseSchedulerKind::Dispatcher;
+    ThrottleMode Throttle = ThrottleMode::Starvation;
+    // Index from EnumerateAdapters for the device, the default adapter if empty
+    std::optional<uint32_t> AdapterIndex;
+    // Recreate the frame pool when the content size changes, otherwise
+    // frames keep the size the pool was created with
+    bool RecreateOnResize = true;
+    // Hand frames to this many worker threads through a bounded queue
+    // instead of holding them, zero to hold. Workers close each frame once
+    // they're done with it, the release scheduler isn't used. GPU work isn't
+    // timed with more than one worker, they share the immediate context.
+    uint32_t WorkerCount = 0;
+    // Capacity of the worker queue, the buffer count if zero
+    uint32_t QueueDepth = 0;
+    // Simulated consumer work done on each frame before it is held, or by
+    // the workers
+    WorkloadKind Workload = WorkloadKind::None;
+    std::wstring EncodeOutputPath;
+    PipelineOptions Pipeline;
+    // A ContentGenerator window is among the subjects
+    bool GeneratedContent = false;
+    // Tags the per-frame records written to results sinks
+    uint32_t RunId = 0;
+    uint32_t SessionIndex = 0;
+};
+
+// QPC ticks spent in each step of Start
+struct StartupTimings
+{
+    int64_t CreateItemQpc;
+    int64_t CreateFramePoolQpc;
+    int64_t CreateSessionQpc;
+    int64_t StartCaptureQpc;
+    // From the beginning of Start to the first FrameArrived, zero until
+    // a frame arrives
+    int64_t FirstFrameQpc;
+};
+
+// Runs a single capture session on its own dispatcher queue thread. Each
+// frame is held until the release scheduler closes it, which starves the
+// DWM of buffers when the pool is small. Depending on the configuration,
+// FrameArrived and the release can each run on other threads.
+class CaptureRunner
+{
+public:
+    CaptureRunner(
+        winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& device,
+        CaptureItemSource const& source,
+        CaptureConfig const& config,
+        std::vector<std::shared_ptr<ResultsSink>> const& sinks = {});
+    ~CaptureRunner();
+    CaptureRunner(CaptureRunner const&) = delete;
+    CaptureRunner& operator=(CaptureRunner const&) = delete;
+
+    void Start();
+    void Stop();
+    // Discards everything measured so far, e.g. after a warmup period
+    void ResetStats();
+    // Changes how often held frames are released, or the MinUpdateInterval,
+    // while capturing. Workers don't use an interval.
+    void SetReleaseInterval(std::chrono::milliseconds interval);
+
+    CaptureSummary Summarize() const { return m_stats.Summarize(); }
+    CaptureStats const& Stats() const { return m_stats; }
+    // Available after Start
+    std::wstring const& DisplayName() const { return m_displayName; }
+    StartupTimings GetStartupTimings() const;
+    bool WaitForFirstFrame(std::chrono::milliseconds timeout);
+
+private:
+    uint64_t GetPoolBytes(winrt::Windows::Graphics::SizeInt32 size) const;
+    std::wstring GetEncodeOutputPath(uint32_t workerIndex = 0) const;
+    void RunOnCaptureThread(std::function<void()> const& work);
+    void OnFrameArrived(
+        winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const& sender,
+        winrt::Windows::Foundation::IInspectable const& args);
+    void OnRelease(int64_t scheduledQpc, int64_t actualQpc);
+    void OnWorkerFrame(uint32_t workerIndex, QueuedFrame& frame);
+    void CloseFrame(winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame const& frame, FrameRecord& record, bool overwritten);
+    // Expects m_heldFrameLock to be held
+    void CloseHeldFrame(bool overwritten);
+    // Expects m_heldFrameLock to be held
+    void TrackContentSize(winrt::Windows::Graphics::SizeInt32 contentSize, ID3D11Texture2D* texture, int64_t arrivalQpc);
+
+private:
+    winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device{ nullptr };
+    CaptureItemSource m_source;
+    CaptureConfig m_config;
+    std::wstring m_displayName;
+    std::vector<std::shared_ptr<ResultsSink>> m_sinks;
+
+    winrt::Windows::System::DispatcherQueueController m_controller{ nullptr };
+    winrt::Windows::System::DispatcherQueue m_queue{ nullptr };
+    winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool m_framePool{ nullptr };
+    winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool::FrameArrived_revoker m_frameArrived;
+    winrt::Windows::Graphics::Capture::GraphicsCaptureSession m_session{ nullptr };
+    std::unique_ptr<ReleaseScheduler> m_scheduler;
+    // Guards the workload and counter reader separately so a slow frame
+    // doesn't hold up the release of the previous one
+    std::mutex m_workloadLock;
+    std::unique_ptr<FrameWorkload> m_workload;
+    std::shared_ptr<PresentHistory> m_contentPresents;
+    std::unique_ptr<FrameCounterReader> m_counterReader;
+    std::optional<uint32_t> m_lastContentCounter;
+    // Each worker has its own workload, they aren't thread safe
+    std::unique_ptr<FrameWorkerPool> m_workerPool;
+    std::vector<std::unique_ptr<FrameWorkload>> m_workerWorkloads;
+
+    // Guards the held frame, FrameArrived and the release can run on
+    // different threads.
+    std::mutex m_heldFrameLock;
+    bool m_closed = false;
+    winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame m_heldFrame{ nullptr };
+    FrameRecord m_heldFrameRecord = {};
+    uint64_t m_nextFrameIndex = 0;
+    std::unordered_set<uint64_t> m_seenSurfaces;
+    winrt::Windows::Graphics::SizeInt32 m_poolSize = {};
+    bool m_recreatePending = false;
+    int64_t m_lastArrivalQpc = 0;
+    int64_t m_lastOldSizeArrivalQpc = 0;
+    // Used to infer compositions we didn't get a frame for
+    int64_t m_refreshPeriod = 0;
+    int64_t m_lastSystemRelativeTime = 0;
+
+    StartupTimings m_startupTimings = {};
+    int64_t m_startQpc = 0;
+    std::atomic<int64_t> m_firstFrameQpc{ 0 };
+    wil::slim_event_manual_reset m_firstFrameEvent;
+
+    CaptureStats m_stats;
+    bool m_started = false;
+    bool m_stopped = false;
+};
@@ -0,0 +1,703 @@
+﻿#include "pch.h"
+#include "CaptureStats.h"
+#include "Timing.h"
+
+// Enough gaps that a few late compositions can't make a fixed refresh
+// monitor look variable, and a median error of 10% of a period
+static constexpr uint64_t VariableRefreshMinimumSamples = 30;
+static constexpr uint64_t VariableRefreshAlignmentThreshold = 1000;
+
+CaptureStats::CaptureStats()
+{
+    Start(GetQpcNow());
+}
+
+void CaptureStats::Start(int64_t startQpc)
+{
+    m_holdTime.Reset();
+    m_interArrivalTime.Reset();
+    m_captureLatency.Reset();
+    m_releaseError.Reset();
+    m_resizeGap.Reset();
+    m_vblanksPerFrame.Reset();
+    m_vblankAlignmentError.Reset();
+    m_dirtyRectCount.Reset();
+    m_dirtyAreaFraction.Reset();
+    m_workloadTime.Reset();
+    m_readbackCopyTime.Reset();
+    m_readbackReadTime.Reset();
+    m_compositionToGpuTime.Reset();
+    m_gpuWorkTime.Reset();
+    m_surfaceWaitTime.Reset();
+    m_encoderInputWaitTime.Reset();
+    m_encodeTime.Reset();
+    m_endToEndLatency.Reset();
+    m_surfacesInFlight.Reset();
+    m_presentLatency.Reset();
+    m_queueDepth.Reset();
+    m_queueWaitTime.Reset();
+    m_framesArrived.store(0);
+    m_framesClosed.store(0);
+    m_framesOverwritten.store(0);
+    m_workloadDroppedFrames.store(0);
+    m_poolRecreations.store(0);
+    m_skippedFrames.store(0);
+    m_duplicateFrames.store(0);
+    m_contentFramesDropped.store(0);
+    m_contentFramesRepeated.store(0);
+    m_contentDecodeFailures.store(0);
+    m_queueDroppedFrames.store(0);
+    m_surfaceStalls.store(0);
+    m_encoderInputStalls.store(0);
+    m_framesEncoded.store(0);
+    m_bytesEncoded.store(0);
+    m_bytesArrived.store(0);
+    m_dirtyPixels.store(0);
+    m_contentPixels.store(0);
+    m_lastArrivalQpc.store(0);
+    m_stopQpc.store(0);
+    m_startQpc.store(startQpc);
+}
+
+void CaptureStats::Stop(int64_t stopQpc)
+{
+    m_stopQpc.store(stopQpc);
+}
+
+void CaptureStats::RecordFrameArrived(int64_t systemRelativeTime, int64_t arrivalQpc)
+{
+    m_framesArrived.fetch_add(1, std::memory_order_relaxed);
+
+    auto lastArrivalQpc = m_lastArrivalQpc.exchange(arrivalQpc, std::memory_order_relaxed);
+    if (lastArrivalQpc != 0)
+    {
+        m_interArrivalTime.Record(QpcToMicroseconds(arrivalQpc - lastArrivalQpc));
+    }
+
+    // SystemRelativeTime is when the DWM composed the frame
+    auto latency = QpcToHundredNanoseconds(arrivalQpc) - systemRelativeTime;
+    m_captureLatency.Record(latency / 10);
+}
+
+void CaptureStats::RecordFrameClosed(int64_t arrivalQpc, int64_t closeQpc, bool overwritten)
+{
+    m_framesClosed.fetch_add(1, std::memory_order_relaxed);
+    if (overwritten)
+    {
+        m_framesOverwritten.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_holdTime.Record(QpcToMicroseconds(closeQpc - arrivalQpc));
+}
+
+void CaptureStats::Add(CaptureStats const& other)
+{
+    // The combined window spans every session. This is expected to be
+    // created after the sessions stopped, so our own start is later.
+    m_startQpc.store(std::min(m_startQpc.load(), other.m_startQpc.load()));
+    m_stopQpc.store(std::max(m_stopQpc.load(), other.m_stopQpc.load()));
+
+    m_framesArrived.fetch_add(other.m_framesArrived.load());
+    m_framesClosed.fetch_add(other.m_framesClosed.load());
+    m_framesOverwritten.fetch_add(other.m_framesOverwritten.load());
+    m_workloadDroppedFrames.fetch_add(other.m_workloadDroppedFrames.load());
+    m_poolRecreations.fetch_add(other.m_poolRecreations.load());
+    m_skippedFrames.fetch_add(other.m_skippedFrames.load());
+    m_duplicateFrames.fetch_add(other.m_duplicateFrames.load());
+    m_contentFramesDropped.fetch_add(other.m_contentFramesDropped.load());
+    m_contentFramesRepeated.fetch_add(other.m_contentFramesRepeated.load());
+    m_contentDecodeFailures.fetch_add(other.m_contentDecodeFailures.load());
+    m_queueDroppedFrames.fetch_add(other.m_queueDroppedFrames.load());
+    m_surfaceStalls.fetch_add(other.m_surfaceStalls.load());
+    m_encoderInputStalls.fetch_add(other.m_encoderInputStalls.load());
+    m_framesEncoded.fetch_add(other.m_framesEncoded.load());
+    m_bytesEncoded.fetch_add(other.m_bytesEncoded.load());
+    // Sessions on different monitors don't share a rate, keep the fastest
+    m_refreshRate.store(std::max(m_refreshRate.load(), other.m_refreshRate.load()));
+    m_signalRefreshRate.store(std::max(m_signalRefreshRate.load(), other.m_signalRefreshRate.load()));
+    if (other.m_outputCapabilitiesKnown.load())
+    {
+        m_outputCapabilitiesKnown.store(true);
+    }
+    if (other.m_overlaysSupported.load())
+    {
+        m_overlaysSupported.store(true);
+    }
+    if (other.m_tearingSupported.load())
+    {
+        m_tearingSupported.store(true);
+    }
+    m_bytesArrived.fetch_add(other.m_bytesArrived.load());
+    m_poolBytes.fetch_add(other.m_poolBytes.load());
+    if (other.m_crossAdapter.load())
+    {
+        m_crossAdapter.store(true);
+    }
+    if (other.m_schedulerError.load() != S_OK)
+    {
+        m_schedulerError.store(other.m_schedulerError.load());
+    }
+    m_dirtyPixels.fetch_add(other.m_dirtyPixels.load());
+    m_contentPixels.fetch_add(other.m_contentPixels.load());
+    m_holdTime.Add(other.m_holdTime);
+    m_interArrivalTime.Add(other.m_interArrivalTime);
+    m_captureLatency.Add(other.m_captureLatency);
+    m_releaseError.Add(other.m_releaseError);
+    m_resizeGap.Add(other.m_resizeGap);
+    m_vblanksPerFrame.Add(other.m_vblanksPerFrame);
+    m_vblankAlignmentError.Add(other.m_vblankAlignmentError);
+    m_dirtyRectCount.Add(other.m_dirtyRectCount);
+    m_dirtyAreaFraction.Add(other.m_dirtyAreaFraction);
+    m_workloadTime.Add(other.m_workloadTime);
+    m_readbackCopyTime.Add(other.m_readbackCopyTime);
+    m_readbackReadTime.Add(other.m_readbackReadTime);
+    m_compositionToGpuTime.Add(other.m_compositionToGpuTime);
+    m_gpuWorkTime.Add(other.m_gpuWorkTime);
+    m_surfaceWaitTime.Add(other.m_surfaceWaitTime);
+    m_encoderInputWaitTime.Add(other.m_encoderInputWaitTime);
+    m_encodeTime.Add(other.m_encodeTime);
+    m_endToEndLatency.Add(other.m_endToEndLatency);
+    m_surfacesInFlight.Add(other.m_surfacesInFlight);
+    m_presentLatency.Add(other.m_presentLatency);
+    m_queueDepth.Add(other.m_queueDepth);
+    m_queueWaitTime.Add(other.m_queueWaitTime);
+}
+
+void CaptureStats::RecordRelease(int64_t scheduledQpc, int64_t actualQpc)
+{
+    // Early wakeups count as error too
+    m_releaseError.Record(QpcToMicroseconds(std::abs(actualQpc - scheduledQpc)));
+}
+
+void CaptureStats::SetSchedulerError(HRESULT error)
+{
+    m_schedulerError.store(error, std::memory_order_relaxed);
+}
+
+void CaptureStats::RecordDirtyRegions(uint32_t rectCount, int64_t dirtyPixels, int64_t contentPixels)
+{
+    m_dirtyRectCount.Record(rectCount);
+    if (contentPixels > 0)
+    {
+        m_dirtyAreaFraction.Record((dirtyPixels * 10000) / contentPixels);
+    }
+    m_dirtyPixels.fetch_add(dirtyPixels, std::memory_order_relaxed);
+    m_contentPixels.fetch_add(contentPixels, std::memory_order_relaxed);
+}
+
+void CaptureStats::RecordFrameBytes(uint64_t bytes)
+{
+    m_bytesArrived.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void CaptureStats::SetRefreshRate(double refreshRate)
+{
+    m_refreshRate.store(refreshRate, std::memory_order_relaxed);
+}
+
+void CaptureStats::SetSignalRefreshRate(double refreshRate)
+{
+    m_signalRefreshRate.store(refreshRate, std::memory_order_relaxed);
+}
+
+void CaptureStats::SetOutputCapabilities(OutputCapabilities const& capabilities)
+{
+    m_overlaysSupported.store(capabilities.Overlays, std::memory_order_relaxed);
+    m_tearingSupported.store(capabilities.Tearing, std::memory_order_relaxed);
+    m_outputCapabilitiesKnown.store(true, std::memory_order_release);
+}
+
+void CaptureStats::RecordVblankInterval(int64_t vblanks, int64_t alignmentError)
+{
+    m_vblanksPerFrame.Record(vblanks);
+    m_vblankAlignmentError.Record(alignmentError);
+    if (vblanks == 0)
+    {
+        m_duplicateFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (vblanks > 1)
+    {
+        m_skippedFrames.fetch_add(static_cast<uint64_t>(vblanks - 1), std::memory_order_relaxed);
+    }
+}
+
+void CaptureStats::SetPoolBytes(uint64_t bytes)
+{
+    m_poolBytes.store(bytes, std::memory_order_relaxed);
+}
+
+void CaptureStats::SetCrossAdapter(bool crossAdapter)
+{
+    m_crossAdapter.store(crossAdapter, std::memory_order_relaxed);
+}
+
+void CaptureStats::RecordRecreate()
+{
+    m_poolRecreations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CaptureStats::RecordResize(int64_t gapQpc)
+{
+    m_resizeGap.Record(QpcToMicroseconds(gapQpc));
+}
+
+void CaptureStats::RecordWorkload(int64_t systemRelativeTime, int64_t startQpc, int64_t stopQpc, WorkloadResult const& result)
+{
+    if (result.Dropped)
+    {
+        m_workloadDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_workloadTime.Record(QpcToMicroseconds(stopQpc - startQpc));
+    if (result.CopyQpc.has_value())
+    {
+        m_readbackCopyTime.Record(QpcToMicroseconds(result.CopyQpc.value()));
+    }
+    if (result.ReadQpc.has_value())
+    {
+        m_readbackReadTime.Record(QpcToMicroseconds(result.ReadQpc.value()));
+    }
+    if (result.GpuStartQpc.has_value() && result.GpuDurationQpc.has_value())
+    {
+        auto compositionToGpu = QpcToHundredNanoseconds(result.GpuStartQpc.value()) - systemRelativeTime;
+        m_compositionToGpuTime.Record(compositionToGpu / 10);
+        m_gpuWorkTime.Record(QpcToMicroseconds(result.GpuDurationQpc.value()));
+    }
+    if (result.SurfaceWaitQpc.has_value())
+    {
+        m_surfaceWaitTime.Record(QpcToMicroseconds(result.SurfaceWaitQpc.value()));
+    }
+    if (result.SurfaceStalled)
+    {
+        m_surfaceStalls.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (result.SurfacesInFlight.has_value())
+    {
+        m_surfacesInFlight.Record(result.SurfacesInFlight.value());
+    }
+    // These belong to earlier frames, the encoder finishes them after
+    // their Process call has returned
+    for (auto&& encoded : result.Encoded)
+    {
+        m_encoderInputWaitTime.Record(QpcToMicroseconds(encoded.InputWaitQpc));
+        if (encoded.InputStalled)
+        {
+            m_encoderInputStalls.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_encodeTime.Record(QpcToMicroseconds(encoded.EncodeQpc));
+        m_endToEndLatency.Record(QpcToMicroseconds(encoded.EndToEndQpc));
+        m_framesEncoded.fetch_add(1, std::memory_order_relaxed);
+        m_bytesEncoded.fetch_add(encoded.Bytes, std::memory_order_relaxed);
+    }
+}
+
+void CaptureStats::RecordContentCounterGap(uint32_t gap)
+{
+    if (gap == 0)
+    {
+        m_contentFramesRepeated.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (gap > 1)
+    {
+        m_contentFramesDropped.fetch_add(gap - 1, std::memory_order_relaxed);
+    }
+}
+
+void CaptureStats::RecordContentDecodeFailure()
+{
+    m_contentDecodeFailures.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CaptureStats::RecordPresentLatency(int64_t latencyQpc)
+{
+    m_presentLatency.Record(QpcToMicroseconds(latencyQpc));
+}
+
+void CaptureStats::RecordQueueDepth(size_t depth)
+{
+    m_queueDepth.Record(static_cast<int64_t>(depth));
+}
+
+void CaptureStats::RecordQueueDrop()
+{
+    m_queueDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CaptureStats::RecordQueueWait(int64_t waitQpc)
+{
+    m_queueWaitTime.Record(QpcToMicroseconds(waitQpc));
+}
+
+CaptureSummary CaptureStats::Summarize() const
+{
+    auto startQpc = m_startQpc.load();
+    auto stopQpc = m_stopQpc.load();
+    if (stopQpc == 0)
+    {
+        stopQpc = GetQpcNow();
+    }
+
+    CaptureSummary summary = {};
+    summary.FramesArrived = m_framesArrived.load();
+    summary.FramesClosed = m_framesClosed.load();
+    summary.FramesOverwritten = m_framesOverwritten.load();
+    summary.WorkloadDroppedFrames = m_workloadDroppedFrames.load();
+    summary.PoolRecreations = m_poolRecreations.load();
+    summary.SkippedFrames = m_skippedFrames.load();
+    summary.DuplicateFrames = m_duplicateFrames.load();
+    summary.RefreshRate = m_refreshRate.load();
+    summary.SignalRefreshRate = m_signalRefreshRate.load();
+    summary.VblanksPerFrame = m_vblanksPerFrame.Summarize();
+    summary.VblankAlignmentError = m_vblankAlignmentError.Summarize();
+    // Fixed refresh compositions land within a few percent of the grid,
+    // with variable refresh the error is spread evenly up to half a period
+    summary.VariableRefreshSuspected = summary.VblankAlignmentError.Count >= VariableRefreshMinimumSamples && summary.VblankAlignmentError.P50 > VariableRefreshAlignmentThreshold;
+    if (m_outputCapabilitiesKnown.load(std::memory_order_acquire))
+    {
+        summary.OverlaysSupported = m_overlaysSupported.load();
+        summary.TearingSupported = m_tearingSupported.load();
+    }
+    summary.PoolBytes = m_poolBytes.load();
+    summary.CrossAdapter = m_crossAdapter.load();
+    summary.SchedulerError = m_schedulerError.load();
+    summary.DirtyRectCount = m_dirtyRectCount.Summarize();
+    summary.DirtyAreaFraction = m_dirtyAreaFraction.Summarize();
+    auto contentPixels = m_contentPixels.load();
+    if (contentPixels > 0)
+    {
+        summary.DirtyBandwidthSavedFraction = 1.0 - (static_cast<double>(m_dirtyPixels.load()) / static_cast<double>(contentPixels));
+    }
+    summary.DurationInSeconds = QpcToSeconds(stopQpc - startQpc);
+    if (summary.DurationInSeconds > 0.0)
+    {
+        summary.FramesPerSecond = static_cast<double>(summary.FramesArrived) / summary.DurationInSeconds;
+        if (summary.RefreshRate > 0.0)
+        {
+            summary.RefreshFraction = summary.FramesPerSecond / summary.RefreshRate;
+        }
+        summary.BytesPerSecond = static_cast<double>(m_bytesArrived.load()) / summary.DurationInSeconds;
+    }
+    if (summary.FramesArrived > 0)
+    {
+        summary.BytesPerFrame = static_cast<double>(m_bytesArrived.load()) / static_cast<double>(summary.FramesArrived);
+    }
+    summary.HoldTime = m_holdTime.Summarize();
+    summary.InterArrivalTime = m_interArrivalTime.Summarize();
+    summary.CaptureLatency = m_captureLatency.Summarize();
+    summary.ReleaseError = m_releaseError.Summarize();
+    summary.ResizeGap = m_resizeGap.Summarize();
+    summary.WorkloadTime = m_workloadTime.Summarize();
+    summary.ReadbackCopyTime = m_readbackCopyTime.Summarize();
+    summary.ReadbackReadTime = m_readbackReadTime.Summarize();
+    summary.CompositionToGpuTime = m_compositionToGpuTime.Summarize();
+    summary.GpuWorkTime = m_gpuWorkTime.Summarize();
+    summary.SurfaceWaitTime = m_surfaceWaitTime.Summarize();
+    summary.SurfaceStalls = m_surfaceStalls.load();
+    summary.EncoderInputWaitTime = m_encoderInputWaitTime.Summarize();
+    summary.EncoderInputStalls = m_encoderInputStalls.load();
+    summary.EncodeTime = m_encodeTime.Summarize();
+    summary.EndToEndLatency = m_endToEndLatency.Summarize();
+    summary.SurfacesInFlight = m_surfacesInFlight.Summarize();
+    summary.FramesEncoded = m_framesEncoded.load();
+    summary.BytesEncoded = m_bytesEncoded.load();
+    summary.ContentFramesDropped = m_contentFramesDropped.load();
+    summary.ContentFramesRepeated = m_contentFramesRepeated.load();
+    summary.ContentDecodeFailures = m_contentDecodeFailures.load();
+    summary.PresentLatency = m_presentLatency.Summarize();
+    summary.QueueDroppedFrames = m_queueDroppedFrames.load();
+    summary.QueueDepth = m_queueDepth.Summarize();
+    summary.QueueWaitTime = m_queueWaitTime.Summarize();
+    return summary;
+}
+
+void PrintHistogramHeader(std::wstring const& title)
+{
+    wprintf(L"  %-20s %10s %10s %10s %10s %10s\n", title.c_str(), L"mean", L"p50", L"p90", L"p99", L"max");
+}
+
+void PrintHistogramRow(std::wstring const& name, HistogramSummary const& histogram)
+{
+    if (histogram.Count == 0)
+    {
+        wprintf(L"  %-20s %10s %10s %10s %10s %10s\n", name.c_str(), L"-", L"-", L"-", L"-", L"-");
+        return;
+    }
+    wprintf(L"  %-20s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+        name.c_str(),
+        histogram.Mean / 1000.0,
+        histogram.P50 / 1000.0,
+        histogram.P90 / 1000.0,
+        histogram.P99 / 1000.0,
+        histogram.Max / 1000.0);
+}
+
+// Cost is per delivered frame, what capacity planning works from
+static void PrintUtilization(CaptureSummary const& summary)
+{
+    auto const& utilization = summary.Utilization;
+    auto frames = static_cast<double>(std::max<uint64_t>(summary.FramesArrived, 1));
+    auto duration = std::max(utilization.DurationInSeconds, 0.001);
+    wprintf(L"\n");
+    wprintf(L"  %-20s %10s %10s %12s\n", L"(cost)", L"CPU %", L"CPU ms/f", L"GPU ms/f");
+    auto printRow = [&](wchar_t const* name, std::optional<double> cpuSeconds, std::optional<double> gpuPercent)
+    {
+        if (cpuSeconds.has_value())
+        {
+            wprintf(L"  %-20s %10.1f %10.3f", name, (cpuSeconds.value() * 100.0) / duration, (cpuSeconds.value() * 1000.0) / frames);
+        }
+        else
+        {
+            wprintf(L"  %-20s %10s %10s", name, L"-", L"-");
+        }
+        if (gpuPercent.has_value())
+        {
+            wprintf(L" %12.3f\n", (gpuPercent.value() / 100.0) * duration * 1000.0 / frames);
+        }
+        else
+        {
+            wprintf(L" %12s\n", L"-");
+        }
+    };
+    auto gpu = [&](double percent) { return utilization.GpuAvailable ? std::optional(percent) : std::nullopt; };
+    printRow(L"This process", utilization.ProcessCpuSeconds, gpu(utilization.ProcessGpuPercent));
+    printRow(L"DWM", utilization.DwmCpuAvailable ? std::optional(utilization.DwmCpuSeconds) : std::nullopt, gpu(utilization.DwmGpuPercent));
+    if (!utilization.DwmCpuAvailable)
+    {
+        wprintf(L"  DWM CPU:            unavailable, run elevated to sample it\n");
+    }
+    if (utilization.GpuAvailable)
+    {
+        wprintf(L"  GPU busy:           %.1f%% (peak %.1f%%)\n", utilization.GpuPercent, utilization.GpuPeakPercent);
+    }
+    else
+    {
+        wprintf(L"  GPU busy:           unavailable\n");
+    }
+}
+
+// Stage by stage, so it's clear which one the frame pool is waiting on
+static void PrintEncodePipeline(CaptureSummary const& summary)
+{
+    wprintf(L"\n");
+    PrintHistogramHeader(L"(encode pipeline)");
+    PrintHistogramRow(L"Surface wait", summary.SurfaceWaitTime);
+    PrintHistogramRow(L"NV12 convert", summary.GpuWorkTime);
+    PrintHistogramRow(L"Encoder input wait", summary.EncoderInputWaitTime);
+    PrintHistogramRow(L"Encode", summary.EncodeTime);
+    PrintHistogramRow(L"End to end", summary.EndToEndLatency);
+    wprintf(L"  %-20s %10.2f %10I64u %10I64u %10I64u %10I64u\n",
+        L"Surfaces in flight",
+        summary.SurfacesInFlight.Mean,
+        summary.SurfacesInFlight.P50,
+        summary.SurfacesInFlight.P90,
+        summary.SurfacesInFlight.P99,
+        summary.SurfacesInFlight.Max);
+    wprintf(L"  Frames encoded:     %I64u\n", summary.FramesEncoded);
+    if (summary.DurationInSeconds > 0.0)
+    {
+        wprintf(L"  Encoded bitrate:    %.2f Mbps\n", (static_cast<double>(summary.BytesEncoded) * 8.0) / (summary.DurationInSeconds * 1'000'000.0));
+    }
+    wprintf(L"  Surface stalls:     %I64u\n", summary.SurfaceStalls);
+    wprintf(L"  Input stalls:       %I64u\n", summary.EncoderInputStalls);
+    if (summary.SurfaceStalls > 0)
+    {
+        wprintf(L"  Back-pressure:      the encoder, frames were held waiting for it to free a\n");
+        wprintf(L"                      surface, so the frame pool ran short. Try a deeper pipeline.\n");
+    }
+    else if (summary.EncoderInputStalls > 0)
+    {
+        wprintf(L"  Back-pressure:      the encoder input queue, absorbed by the spare surfaces\n");
+    }
+    else
+    {
+        wprintf(L"  Back-pressure:      none from the encoder, the frame pool or release interval\n");
+        wprintf(L"                      is the limit\n");
+    }
+}
+
+void PrintCaptureSummary(CaptureSummary const& summary)
+{
+    wprintf(L"Capture summary:\n");
+    wprintf(L"  Duration:           %.3f s\n", summary.DurationInSeconds);
+    wprintf(L"  Frames arrived:     %I64u\n", summary.FramesArrived);
+    wprintf(L"  Frames closed:      %I64u\n", summary.FramesClosed);
+    wprintf(L"  Frames overwritten: %I64u\n", summary.FramesOverwritten);
+    if (summary.RefreshRate > 0.0)
+    {
+        wprintf(L"  Capture rate:       %.2f fps (%.1f%% of refresh)\n", summary.FramesPerSecond, summary.RefreshFraction * 100.0);
+        wprintf(L"  Refresh rate:       %.2f Hz", summary.RefreshRate);
+        if (summary.SignalRefreshRate > 0.0 && std::abs(summary.SignalRefreshRate - summary.RefreshRate) > 0.5)
+        {
+            wprintf(L" (signal %.2f Hz)", summary.SignalRefreshRate);
+        }
+        wprintf(L"\n");
+    }
+    else
+    {
+        wprintf(L"  Capture rate:       %.2f fps\n", summary.FramesPerSecond);
+    }
+    auto describeSupport = [](std::optional<bool> const& supported) { return !supported.has_value() ? L"unknown" : supported.value() ? L"supported" : L"no"; };
+    wprintf(L"  Overlays (MPO):     %s\n", describeSupport(summary.OverlaysSupported));
+    wprintf(L"  Tearing (for VRR):  %s\n", describeSupport(summary.TearingSupported));
+    wprintf(L"  Dropped vblanks:    %I64u\n", summary.SkippedFrames);
+    wprintf(L"  Duplicate frames:   %I64u\n", summary.DuplicateFrames);
+    wprintf(L"  Pool memory:        %.1f MB\n", summary.PoolBytes / (1024.0 * 1024.0));
+    wprintf(L"  Cross-adapter:      %s\n", summary.CrossAdapter ? L"yes" : L"no");
+    if (summary.SchedulerError != S_OK)
+    {
+        wprintf(L"  Releases stopped:   %s\n", winrt::hresult_error(summary.SchedulerError).message().c_str());
+    }
+    wprintf(L"  Frame size:         %.2f MB (%.1f MB/s)\n", summary.BytesPerFrame / (1024.0 * 1024.0), summary.BytesPerSecond / (1024.0 * 1024.0));
+    wprintf(L"\n");
+    PrintHistogramHeader(L"(ms)");
+    PrintHistogramRow(L"Hold time", summary.HoldTime);
+    PrintHistogramRow(L"Inter-arrival gap", summary.InterArrivalTime);
+    PrintHistogramRow(L"Capture latency", summary.CaptureLatency);
+    PrintHistogramRow(L"Release error", summary.ReleaseError);
+    if (summary.PresentLatency.Count > 0 || summary.ContentDecodeFailures > 0)
+    {
+        PrintHistogramRow(L"Present to capture", summary.PresentLatency);
+        wprintf(L"  Content dropped:    %I64u\n", summary.ContentFramesDropped);
+        wprintf(L"  Content repeated:   %I64u\n", summary.ContentFramesRepeated);
+        wprintf(L"  Unreadable counter: %I64u\n", summary.ContentDecodeFailures);
+    }
+    if (summary.PoolRecreations > 0)
+    {
+        PrintHistogramRow(L"Resize gap", summary.ResizeGap);
+        wprintf(L"  Pool recreations:   %I64u\n", summary.PoolRecreations);
+    }
+    if (summary.WorkloadTime.Count > 0)
+    {
+        PrintHistogramRow(L"Workload time", summary.WorkloadTime);
+        if (summary.ReadbackCopyTime.Count > 0)
+        {
+            PrintHistogramRow(L"Readback copy", summary.ReadbackCopyTime);
+            PrintHistogramRow(L"Readback CPU read", summary.ReadbackReadTime);
+        }
+        if (summary.GpuWorkTime.Count > 0)
+        {
+            PrintHistogramRow(L"Composition to GPU", summary.CompositionToGpuTime);
+            PrintHistogramRow(L"GPU work", summary.GpuWorkTime);
+        }
+        wprintf(L"  Workload dropped:   %I64u\n", summary.WorkloadDroppedFrames);
+    }
+    if (summary.QueueDepth.Count > 0)
+    {
+        PrintHistogramRow(L"Queue wait", summary.QueueWaitTime);
+    }
+    // Tables with their own units go after every ms row
+    if (summary.Utilization.Sampled)
+    {
+        PrintUtilization(summary);
+    }
+    if (summary.VblanksPerFrame.Count > 0 && summary.RefreshRate > 0.0)
+    {
+        wprintf(L"\n");
+        PrintHistogramHeader(L"(vblanks)");
+        wprintf(L"  %-20s %10.2f %10I64u %10I64u %10I64u %10I64u\n",
+            L"Vblanks per frame",
+            summary.VblanksPerFrame.Mean,
+            summary.VblanksPerFrame.P50,
+            summary.VblanksPerFrame.P90,
+            summary.VblanksPerFrame.P99,
+            summary.VblanksPerFrame.Max);
+        wprintf(L"  %-20s %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+            L"Vblank error (%)",
+            summary.VblankAlignmentError.Mean / 100.0,
+            summary.VblankAlignmentError.P50 / 100.0,
+            summary.VblankAlignmentError.P90 / 100.0,
+            summary.VblankAlignmentError.P99 / 100.0,
+            summary.VblankAlignmentError.Max / 100.0);
+        wprintf(L"  Effective interval: %.3f ms\n", (summary.VblanksPerFrame.Mean * 1000.0) / summary.RefreshRate);
+        if (summary.VariableRefreshSuspected)
+        {
+            wprintf(L"  Variable refresh:   likely, frames don't line up with %.2f Hz vblanks so the\n", summary.RefreshRate);
+            wprintf(L"                      vblank counts are only approximate\n");
+        }
+    }
+    if (summary.DirtyRectCount.Count > 0)
+    {
+        wprintf(L"\n");
+        wprintf(L"  %-20s %10s %10s %10s %10s %10s\n", L"(dirty regions)", L"mean", L"p50", L"p90", L"p99", L"max");
+        wprintf(L"  %-20s %10.1f %10I64u %10I64u %10I64u %10I64u\n",
+            L"Rects per frame",
+            summary.DirtyRectCount.Mean,
+            summary.DirtyRectCount.P50,
+            summary.DirtyRectCount.P90,
+            summary.DirtyRectCount.P99,
+            summary.DirtyRectCount.Max);
+        wprintf(L"  %-20s %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+            L"Area covered (%)",
+            summary.DirtyAreaFraction.Mean / 100.0,
+            summary.DirtyAreaFraction.P50 / 100.0,
+            summary.DirtyAreaFraction.P90 / 100.0,
+            summary.DirtyAreaFraction.P99 / 100.0,
+            summary.DirtyAreaFraction.Max / 100.0);
+        wprintf(L"  Copy bandwidth saved by dirty rects: %.1f%%\n", summary.DirtyBandwidthSavedFraction * 100.0);
+    }
+    if (summary.SurfacesInFlight.Count > 0)
+    {
+        PrintEncodePipeline(summary);
+    }
+    if (summary.QueueDepth.Count > 0)
+    {
+        wprintf(L"\n");
+        PrintHistogramHeader(L"(worker queue)");
+        wprintf(L"  %-20s %10.2f %10I64u %10I64u %10I64u %10I64u\n",
+            L"Depth at enqueue",
+            summary.QueueDepth.Mean,
+            summary.QueueDepth.P50,
+            summary.QueueDepth.P90,
+            summary.QueueDepth.P99,
+            summary.QueueDepth.Max);
+        wprintf(L"  Queue full drops:   %I64u\n", summary.QueueDroppedFrames);
+    }
+}
+
+void PrintCaptureSummaryTable(std::vector<LabeledCaptureSummary> const& summaries)
+{
+    wprintf(L"%-24s %8s %8s %7s %8s %8s %8s %8s %6s %9s %9s %9s %9s %9s %9s %9s %9s %7s\n",
+        L"Configuration", L"Frames", L"FPS", L"% Rfsh", L"Overwr", L"Skipped", L"Pool MB", L"MB/s", L"X-GPU",
+        L"Hold p50", L"Hold p99", L"Gap p50", L"Gap p99", L"Lat p50", L"Lat p99", L"Rel p99", L"CPU ms/f", L"GPU %");
+    for (auto const& labeled : summaries)
+    {
+        auto const& summary = labeled.Summary;
+        auto const& utilization = summary.Utilization;
+        auto cpuPerFrame = utilization.Sampled && summary.FramesArrived > 0 ? (utilization.ProcessCpuSeconds * 1000.0) / summary.FramesArrived : 0.0;
+        auto gpuPercent = utilization.GpuAvailable ? utilization.GpuPercent : 0.0;
+        wprintf(L"%-24s %8I64u %8.2f %7.1f %8I64u %8I64u %8.1f %8.1f %6s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %7.1f\n",
+            labeled.Label.c_str(),
+            summary.FramesArrived,
+            summary.FramesPerSecond,
+            summary.RefreshFraction * 100.0,
+            summary.FramesOverwritten,
+            summary.SkippedFrames,
+            summary.PoolBytes / (1024.0 * 1024.0),
+            summary.BytesPerSecond / (1024.0 * 1024.0),
+            summary.CrossAdapter ? L"yes" : L"no",
+            summary.HoldTime.P50 / 1000.0,
+            summary.HoldTime.P99 / 1000.0,
+            summary.InterArrivalTime.P50 / 1000.0,
+            summary.InterArrivalTime.P99 / 1000.0,
+            summary.CaptureLatency.P50 / 1000.0,
+            summary.CaptureLatency.P99 / 1000.0,
+            summary.ReleaseError.P99 / 1000.0,
+            cpuPerFrame,
+            gpuPercent);
+    }
+    wprintf(L"(times in ms)\n");
+}
+
+void PrintMultiCaptureSummary(MultiCaptureSummary const& summary)
+{
+    if (summary.Sessions.size() == 1)
+    {
+        PrintCaptureSummary(summary.Sessions.front().Summary);
+        return;
+    }
+
+    auto rows = summary.Sessions;
+    rows.push_back({ L"Aggregate", summary.Aggregate });
+    PrintCaptureSummaryTable(rows);
+
+    wprintf(L"\n");
+    PrintCaptureSummary(summary.Aggregate);
+}
@@ -0,0 +1,229 @@
+﻿#pragma once
+#include "DisplayInfo.h"
+#include "Histogram.h"
+#include "FrameWorkload.h"
+#include "UtilizationSampler.h"
+
+// All histogram values are in microseconds
+struct CaptureSummary
+{
+    uint64_t FramesArrived;
+    uint64_t FramesClosed;
+    uint64_t FramesOverwritten;
+    // Frames the workload couldn't take, e.g. the encoder was backed up
+    uint64_t WorkloadDroppedFrames;
+    uint64_t PoolRecreations;
+    // Vblanks between two delivered frames that we didn't get a frame
+    // for, inferred from SystemRelativeTime and the refresh period
+    uint64_t SkippedFrames;
+    // Frames composed within the same vblank as the previous one
+    uint64_t DuplicateFrames;
+    // Of the captured monitor, zero if unknown
+    double RefreshRate;
+    // Of the video signal, zero if unknown or the same as RefreshRate
+    double SignalRefreshRate;
+    // FramesPerSecond over RefreshRate, zero if the refresh rate is unknown
+    double RefreshFraction;
+    // Refresh periods from one frame's SystemRelativeTime to the next,
+    // unitless rather than microseconds
+    HistogramSummary VblanksPerFrame;
+    // How far each of those gaps was from a whole number of refresh
+    // periods, in hundredths of a percent of a period
+    HistogramSummary VblankAlignmentError;
+    // Compositions don't land on the nominal vblank grid, the monitor is
+    // likely running at a variable refresh rate
+    bool VariableRefreshSuspected;
+    // What the captured monitor's output supports, empty if it couldn't be
+    // queried, e.g. for a window or when DXGI has no output for the monitor
+    std::optional<bool> OverlaysSupported;
+    std::optional<bool> TearingSupported;
+    // GPU memory held by the frame pool buffers
+    uint64_t PoolBytes;
+    // The capture device is on a different adapter than the monitor
+    bool CrossAdapter;
+    // Content bytes per delivered frame, and per second
+    double BytesPerFrame;
+    double BytesPerSecond;
+    // Dirty region reporting only. Rects per frame, the covered area in
+    // hundredths of a percent, and how much of the full frame bandwidth a
+    // consumer copying only dirty rects would have saved.
+    HistogramSummary DirtyRectCount;
+    HistogramSummary DirtyAreaFraction;
+    double DirtyBandwidthSavedFraction;
+    double DurationInSeconds;
+    double FramesPerSecond;
+    HistogramSummary HoldTime;
+    HistogramSummary InterArrivalTime;
+    HistogramSummary CaptureLatency;
+    // How late each release ran compared to when it was scheduled
+    HistogramSummary ReleaseError;
+    // Why the release scheduler stopped early, S_OK if it didn't
+    HRESULT SchedulerError;
+    // From the last frame at the old size to the first frame in a
+    // recreated buffer
+    HistogramSummary ResizeGap;
+    // Time spent in the per-frame workload, if one is configured
+    HistogramSummary WorkloadTime;
+    // Readback workload only. GPU copy of each frame, and the CPU map and
+    // copy out of a staging texture filled a few frames earlier.
+    HistogramSummary ReadbackCopyTime;
+    HistogramSummary ReadbackReadTime;
+    // From SystemRelativeTime to the workload's GPU work starting, and how
+    // long the GPU work took, from timestamp queries
+    HistogramSummary CompositionToGpuTime;
+    HistogramSummary GpuWorkTime;
+    // Pipeline workload only. Waiting for a free NV12 surface while holding
+    // the frame, and frames that had to. Converted frames waiting for the
+    // encoder to ask for input, and frames that had to. Encoder time, and
+    // SystemRelativeTime to encoded sample. NV12 surfaces in use after each
+    // frame took one (unitless).
+    HistogramSummary SurfaceWaitTime;
+    uint64_t SurfaceStalls;
+    HistogramSummary EncoderInputWaitTime;
+    uint64_t EncoderInputStalls;
+    HistogramSummary EncodeTime;
+    HistogramSummary EndToEndLatency;
+    HistogramSummary SurfacesInFlight;
+    uint64_t FramesEncoded;
+    uint64_t BytesEncoded;
+    // Generated content only. Counter values that never reached us, ones
+    // delivered again, and frames the counter couldn't be read from.
+    uint64_t ContentFramesDropped;
+    uint64_t ContentFramesRepeated;
+    uint64_t ContentDecodeFailures;
+    // From the generator's Present to FrameArrived
+    HistogramSummary PresentLatency;
+    // Worker pool only. Frames dropped because the queue was full, frames
+    // already waiting when each one was queued (unitless), and how long
+    // each waited for a worker.
+    uint64_t QueueDroppedFrames;
+    HistogramSummary QueueDepth;
+    HistogramSummary QueueWaitTime;
+    // Process wide, filled in by whoever ran the sessions rather than by
+    // CaptureStats
+    UtilizationSummary Utilization;
+};
+
+// Collects per-frame timing for a capture session. Recording is lock-free so
+// it can be called from the FrameArrived handler and the release timer
+// without adding contention to the path we're trying to measure.
+class CaptureStats
+{
+public:
+    CaptureStats();
+    CaptureStats(CaptureStats const&) = delete;
+    CaptureStats& operator=(CaptureStats const&) = delete;
+
+    void Start(int64_t startQpc);
+    void Stop(int64_t stopQpc);
+
+    // systemRelativeTime is the frame's SystemRelativeTime in 100ns units
+    void RecordFrameArrived(int64_t systemRelativeTime, int64_t arrivalQpc);
+    // overwritten is true when the frame was replaced before it was released
+    void RecordFrameClosed(int64_t arrivalQpc, int64_t closeQpc, bool overwritten = false);
+    void RecordRelease(int64_t scheduledQpc, int64_t actualQpc);
+    void SetSchedulerError(HRESULT error);
+    void RecordDirtyRegions(uint32_t rectCount, int64_t dirtyPixels, int64_t contentPixels);
+    void RecordFrameBytes(uint64_t bytes);
+    void SetRefreshRate(double refreshRate);
+    void SetSignalRefreshRate(double refreshRate);
+    void SetOutputCapabilities(OutputCapabilities const& capabilities);
+    // vblanks is the SystemRelativeTime gap in refresh periods, rounded,
+    // and alignmentError what was rounded off in hundredths of a percent
+    // of a period
+    void RecordVblankInterval(int64_t vblanks, int64_t alignmentError);
+    void SetPoolBytes(uint64_t bytes);
+    void SetCrossAdapter(bool crossAdapter);
+    void RecordRecreate();
+    void RecordResize(int64_t gapQpc);
+    void RecordWorkload(int64_t systemRelativeTime, int64_t startQpc, int64_t stopQpc, WorkloadResult const& result);
+    // gap is the difference between this frame's counter and the last one
+    void RecordContentCounterGap(uint32_t gap);
+    void RecordContentDecodeFailure();
+    void RecordPresentLatency(int64_t latencyQpc);
+    void RecordQueueDepth(size_t depth);
+    void RecordQueueDrop();
+    void RecordQueueWait(int64_t waitQpc);
+
+    // Combines the samples of a session that ran at the same time as this one
+    void Add(CaptureStats const& other);
+
+    CaptureSummary Summarize() const;
+
+private:
+    std::atomic<int64_t> m_startQpc;
+    std::atomic<int64_t> m_stopQpc;
+    std::atomic<int64_t> m_lastArrivalQpc;
+    std::atomic<uint64_t> m_framesArrived;
+    std::atomic<uint64_t> m_framesClosed;
+    std::atomic<uint64_t> m_framesOverwritten;
+    std::atomic<uint64_t> m_workloadDroppedFrames;
+    std::atomic<uint64_t> m_poolRecreations;
+    std::atomic<uint64_t> m_skippedFrames;
+    std::atomic<uint64_t> m_duplicateFrames;
+    std::atomic<uint64_t> m_contentFramesDropped;
+    std::atomic<uint64_t> m_contentFramesRepeated;
+    std::atomic<uint64_t> m_contentDecodeFailures;
+    std::atomic<uint64_t> m_queueDroppedFrames;
+    std::atomic<uint64_t> m_surfaceStalls;
+    std::atomic<uint64_t> m_encoderInputStalls;
+    std::atomic<uint64_t> m_framesEncoded;
+    std::atomic<uint64_t> m_bytesEncoded;
+    std::atomic<uint64_t> m_bytesArrived;
+    // Not reset by Start, it describes the pool rather than the samples
+    std::atomic<uint64_t> m_poolBytes{ 0 };
+    std::atomic<bool> m_crossAdapter{ false };
+    std::atomic<HRESULT> m_schedulerError{ S_OK };
+    std::atomic<double> m_refreshRate{ 0.0 };
+    std::atomic<double> m_signalRefreshRate{ 0.0 };
+    // The capabilities below are only meaningful once this is set
+    std::atomic<bool> m_outputCapabilitiesKnown{ false };
+    std::atomic<bool> m_overlaysSupported{ false };
+    std::atomic<bool> m_tearingSupported{ false };
+    std::atomic<int64_t> m_dirtyPixels;
+    std::atomic<int64_t> m_contentPixels;
+    Histogram m_holdTime;
+    Histogram m_interArrivalTime;
+    Histogram m_captureLatency;
+    Histogram m_releaseError;
+    Histogram m_resizeGap;
+    Histogram m_vblanksPerFrame;
+    Histogram m_vblankAlignmentError;
+    Histogram m_dirtyRectCount;
+    Histogram m_dirtyAreaFraction;
+    Histogram m_workloadTime;
+    Histogram m_readbackCopyTime;
+    Histogram m_readbackReadTime;
+    Histogram m_compositionToGpuTime;
+    Histogram m_gpuWorkTime;
+    Histogram m_surfaceWaitTime;
+    Histogram m_encoderInputWaitTime;
+    Histogram m_encodeTime;
+    Histogram m_endToEndLatency;
+    Histogram m_surfacesInFlight;
+    Histogram m_presentLatency;
+    Histogram m_queueDepth;
+    Histogram m_queueWaitTime;
+};
+
+struct LabeledCaptureSummary
+{
+    std::wstring Label;
+    CaptureSummary Summary;
+};
+
+// Sessions that were captured concurrently
+struct MultiCaptureSummary
+{
+    std::vector<LabeledCaptureSummary> Sessions;
+    CaptureSummary Aggregate;
+};
+
+// Rows of mean/p50/p90/p99/max in ms, for histograms in microseconds
+void PrintHistogramHeader(std::wstring const& title);
+void PrintHistogramRow(std::wstring const& name, HistogramSummary const& histogram);
+void PrintCaptureSummary(CaptureSummary const& summary);
+// Prints one row per summary, used to compare several configurations
+void PrintCaptureSummaryTable(std::vector<LabeledCaptureSummary> const& summaries);
+// Prints a single summary, or per-session rows plus the aggregate
+void PrintMultiCaptureSummary(MultiCaptureSummary const& summary);
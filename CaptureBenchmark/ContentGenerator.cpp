@@ -0,0 +1,246 @@
+﻿#include "pch.h"
+#include "ContentGenerator.h"
+#include "Timing.h"
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+    using namespace robmikh::common::desktop;
+}
+
+void PresentHistory::Record(uint32_t frameIndex, int64_t presentQpc)
+{
+    // Invalidate the slot first so a reader never pairs the new index with
+    // the old time
+    auto& entry = m_entries[frameIndex % Capacity];
+    entry.FrameIndex.store(UINT32_MAX, std::memory_order_relaxed);
+    entry.PresentQpc.store(presentQpc, std::memory_order_release);
+    entry.FrameIndex.store(frameIndex, std::memory_order_release);
+}
+
+std::optional<int64_t> PresentHistory::Find(uint32_t frameIndex) const
+{
+    auto const& entry = m_entries[frameIndex % Capacity];
+    if (entry.FrameIndex.load(std::memory_order_acquire) != frameIndex)
+    {
+        return std::nullopt;
+    }
+    auto presentQpc = entry.PresentQpc.load(std::memory_order_acquire);
+    if (entry.FrameIndex.load(std::memory_order_acquire) != frameIndex)
+    {
+        return std::nullopt;
+    }
+    return std::optional(presentQpc);
+}
+
+const std::wstring ContentGenerator::ClassName = L"CaptureRateTest.ContentGenerator";
+
+void ContentGenerator::RegisterWindowClass()
+{
+    static std::once_flag registered;
+    std::call_once(registered, []()
+        {
+            auto instance = winrt::check_pointer(GetModuleHandleW(nullptr));
+            WNDCLASSEXW wcex = {};
+            wcex.cbSize = sizeof(wcex);
+            wcex.style = CS_HREDRAW | CS_VREDRAW;
+            wcex.lpfnWndProc = WndProc;
+            wcex.hInstance = instance;
+            wcex.hCursor = LoadCursorW(nullptr, IDC_ARROW);
+            wcex.lpszClassName = ClassName.c_str();
+            winrt::check_bool(RegisterClassExW(&wcex));
+        });
+}
+
+ContentGenerator::ContentGenerator(ContentOptions const& options)
+{
+    m_options = options;
+    RegisterWindowClass();
+
+    // The window belongs to the thread that pumps its messages
+    m_thread = std::thread([this]()
+        {
+            try
+            {
+                CreateWindowAndSwapChain();
+            }
+            catch (...)
+            {
+                m_startupError = std::current_exception();
+                m_readyEvent.SetEvent();
+                return;
+            }
+            m_readyEvent.SetEvent();
+            // A removed device or a failed Present stops the frames, not
+            // the benchmark. The window stays up so the capture carries on.
+            try
+            {
+                Run();
+            }
+            catch (...)
+            {
+                m_error.store(winrt::to_hresult());
+                PumpMessagesUntilStopped();
+            }
+            DestroyWindow(m_window);
+        });
+    m_readyEvent.wait();
+    if (m_startupError)
+    {
+        m_thread.join();
+        std::rethrow_exception(m_startupError);
+    }
+}
+
+ContentGenerator::~ContentGenerator()
+{
+    m_stopping.store(true);
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+LRESULT ContentGenerator::MessageHandler(UINT const message, WPARAM const wparam, LPARAM const lparam)
+{
+    switch (message)
+    {
+    case WM_DESTROY:
+        // The thread stops on its own, there's nothing to quit
+        return 0;
+    }
+    return base_type::MessageHandler(message, wparam, lparam);
+}
+
+void ContentGenerator::CreateWindowAndSwapChain()
+{
+    // No frame, so the captured surface is exactly the swap chain
+    auto instance = winrt::check_pointer(GetModuleHandleW(nullptr));
+    winrt::check_pointer(CreateWindowExW(0, ClassName.c_str(), L"CaptureRateTest Content", WS_POPUP,
+        0, 0, m_options.Size.Width, m_options.Size.Height, nullptr, nullptr, instance, this));
+    WINRT_ASSERT(m_window);
+
+    // Our own device, so presenting doesn't contend with the capture device
+    m_d3dDevice = util::CreateD3DDevice(D3D11_CREATE_DEVICE_BGRA_SUPPORT);
+    winrt::com_ptr<ID3D11DeviceContext> d3dContext;
+    m_d3dDevice->GetImmediateContext(d3dContext.put());
+    m_d3dContext = d3dContext.as<ID3D11DeviceContext1>();
+    winrt::com_ptr<IDXGIAdapter> adapter;
+    winrt::check_hresult(m_d3dDevice.as<IDXGIDevice>()->GetAdapter(adapter.put()));
+    winrt::com_ptr<IDXGIFactory2> dxgiFactory;
+    winrt::check_hresult(adapter->GetParent(winrt::guid_of<IDXGIFactory2>(), dxgiFactory.put_void()));
+
+    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+    swapChainDesc.Width = static_cast<uint32_t>(m_options.Size.Width);
+    swapChainDesc.Height = static_cast<uint32_t>(m_options.Size.Height);
+    swapChainDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    swapChainDesc.SampleDesc.Count = 1;
+    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.BufferCount = 2;
+    swapChainDesc.Scaling = DXGI_SCALING_NONE;
+    swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+    swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+    winrt::check_hresult(dxgiFactory->CreateSwapChainForHwnd(m_d3dDevice.get(), m_window, &swapChainDesc, nullptr, nullptr, m_swapChain.put()));
+
+    m_timer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+    winrt::check_bool(m_timer.is_valid());
+
+    // Don't take focus away from the console
+    ShowWindow(m_window, SW_SHOWNOACTIVATE);
+}
+
+void ContentGenerator::Run()
+{
+    auto intervalQpc = GetQpcFrequency() / static_cast<int64_t>(m_options.FramesPerSecond);
+    auto deadlineQpc = GetQpcNow();
+    uint32_t frameIndex = 0;
+    while (!m_stopping.load())
+    {
+        RenderFrame(frameIndex);
+        // Recorded first, the frame can't be captured before it's presented
+        m_presents->Record(frameIndex, GetQpcNow());
+        winrt::check_hresult(m_swapChain->Present(0, 0));
+        m_framesPresented.fetch_add(1);
+        frameIndex++;
+
+        // Absolute deadlines keep the cadence from drifting, and ticks we
+        // already missed are skipped rather than presented in a burst
+        deadlineQpc += intervalQpc;
+        auto nowQpc = GetQpcNow();
+        if (deadlineQpc < nowQpc)
+        {
+            auto missed = ((nowQpc - deadlineQpc) / intervalQpc) + 1;
+            m_missedTicks.fetch_add(static_cast<uint64_t>(missed));
+            deadlineQpc += missed * intervalQpc;
+        }
+        LARGE_INTEGER dueTime = {};
+        dueTime.QuadPart = -QpcToHundredNanoseconds(deadlineQpc - nowQpc);
+        winrt::check_bool(SetWaitableTimerEx(m_timer.get(), &dueTime, 0, nullptr, nullptr, nullptr, 0));
+
+        // Keep pumping messages while we wait for the next tick
+        auto timer = m_timer.get();
+        while (MsgWaitForMultipleObjects(1, &timer, FALSE, INFINITE, QS_ALLINPUT) == WAIT_OBJECT_0 + 1)
+        {
+            MSG msg = {};
+            while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&msg);
+                DispatchMessageW(&msg);
+            }
+        }
+    }
+}
+
+void ContentGenerator::PumpMessagesUntilStopped()
+{
+    while (!m_stopping.load())
+    {
+        MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT);
+        MSG msg = {};
+        while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
+    }
+}
+
+void ContentGenerator::RenderFrame(uint32_t frameIndex)
+{
+    winrt::com_ptr<ID3D11Texture2D> backBuffer;
+    winrt::check_hresult(m_swapChain->GetBuffer(0, winrt::guid_of<ID3D11Texture2D>(), backBuffer.put_void()));
+    winrt::com_ptr<ID3D11RenderTargetView> renderTargetView;
+    winrt::check_hresult(m_d3dDevice->CreateRenderTargetView(backBuffer.get(), nullptr, renderTargetView.put()));
+
+    // Cycle the background so every pixel changes on every frame
+    auto phase = static_cast<float>(frameIndex % 256) / 255.0f;
+    float background[4] = { phase, 1.0f - phase, 0.5f, 1.0f };
+    m_d3dContext->ClearView(renderTargetView.get(), background, nullptr, 0);
+
+    float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    D3D11_RECT counterRect = {};
+    counterRect.left = CounterMargin;
+    counterRect.top = CounterMargin;
+    counterRect.right = CounterMargin + (CounterTilesPerRow * CounterTileSize);
+    counterRect.bottom = CounterMargin + (((CounterBits + CounterTilesPerRow - 1) / CounterTilesPerRow) * CounterTileSize);
+    m_d3dContext->ClearView(renderTargetView.get(), black, &counterRect, 1);
+
+    std::array<D3D11_RECT, CounterBits> setTiles = {};
+    uint32_t setTileCount = 0;
+    for (int32_t bit = 0; bit < CounterBits; bit++)
+    {
+        if ((frameIndex >> bit) & 1)
+        {
+            auto& tile = setTiles[setTileCount++];
+            tile.left = CounterMargin + ((bit % CounterTilesPerRow) * CounterTileSize);
+            tile.top = CounterMargin + ((bit / CounterTilesPerRow) * CounterTileSize);
+            tile.right = tile.left + CounterTileSize;
+            tile.bottom = tile.top + CounterTileSize;
+        }
+    }
+    if (setTileCount > 0)
+    {
+        m_d3dContext->ClearView(renderTargetView.get(), white, setTiles.data(), setTileCount);
+    }
+}
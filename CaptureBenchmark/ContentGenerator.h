@@ -0,0 +1,86 @@
+﻿#pragma once
+
+struct ContentOptions
+{
+    uint32_t FramesPerSecond = 60;
+    winrt::Windows::Graphics::SizeInt32 Size = { 1280, 720 };
+};
+
+// The frame counter is drawn as a grid of black and white tiles in the
+// top left corner, least significant bit first
+constexpr int32_t CounterTileSize = 16;
+constexpr int32_t CounterTilesPerRow = 8;
+constexpr int32_t CounterBits = 32;
+// Keeps the tiles clear of anything the DWM draws at the window's edge
+constexpr int32_t CounterMargin = CounterTileSize;
+
+// When each of the most recent frames was presented. Written by the generator
+// thread and read from FrameArrived handlers without a lock.
+class PresentHistory
+{
+public:
+    // Several seconds of frames at any sensible rate
+    static constexpr uint32_t Capacity = 1024;
+
+    void Record(uint32_t frameIndex, int64_t presentQpc);
+    // Empty once the frame has been overwritten by a newer one
+    std::optional<int64_t> Find(uint32_t frameIndex) const;
+
+private:
+    struct Entry
+    {
+        std::atomic<uint32_t> FrameIndex{ UINT32_MAX };
+        std::atomic<int64_t> PresentQpc{ 0 };
+    };
+    std::array<Entry, Capacity> m_entries;
+};
+
+// A borderless window presenting a flip model swap chain at a fixed rate from
+// its own thread. Every frame changes the whole surface and carries its index,
+// so capturing it gives the same load on every run.
+class ContentGenerator : public robmikh::common::desktop::DesktopWindow<ContentGenerator>
+{
+public:
+    static const std::wstring ClassName;
+
+    ContentGenerator(ContentOptions const& options);
+    ~ContentGenerator();
+    ContentGenerator(ContentGenerator const&) = delete;
+    ContentGenerator& operator=(ContentGenerator const&) = delete;
+
+    HWND Window() const { return m_window; }
+    ContentOptions const& Options() const { return m_options; }
+    std::shared_ptr<PresentHistory> const& Presents() const { return m_presents; }
+    uint64_t FramesPresented() const { return m_framesPresented.load(); }
+    // Ticks where the previous frame was still being drawn or presented
+    uint64_t MissedTicks() const { return m_missedTicks.load(); }
+    // Why the generator stopped presenting, S_OK while it's still going
+    HRESULT Error() const { return m_error.load(); }
+
+    LRESULT MessageHandler(UINT const message, WPARAM const wparam, LPARAM const lparam);
+
+private:
+    static void RegisterWindowClass();
+    void CreateWindowAndSwapChain();
+    void Run();
+    // Keeps the window responsive once presenting has failed
+    void PumpMessagesUntilStopped();
+    void RenderFrame(uint32_t frameIndex);
+
+private:
+    ContentOptions m_options;
+    winrt::com_ptr<ID3D11Device> m_d3dDevice;
+    winrt::com_ptr<ID3D11DeviceContext1> m_d3dContext;
+    winrt::com_ptr<IDXGISwapChain1> m_swapChain;
+    wil::unique_handle m_timer;
+    std::shared_ptr<PresentHistory> m_presents = std::make_shared<PresentHistory>();
+
+    std::thread m_thread;
+    std::atomic<bool> m_stopping{ false };
+    wil::slim_event_manual_reset m_readyEvent;
+    std::exception_ptr m_startupError;
+
+    std::atomic<uint64_t> m_framesPresented{ 0 };
+    std::atomic<uint64_t> m_missedTicks{ 0 };
+    std::atomic<HRESULT> m_error{ S_OK };
+};
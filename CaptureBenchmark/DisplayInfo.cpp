@@ -0,0 +1,160 @@
+﻿#include "pch.h"
+#include "DisplayInfo.h"
+
+struct DisplayPath
+{
+    DISPLAYCONFIG_PATH_INFO Path;
+    std::optional<DISPLAYCONFIG_SOURCE_MODE> SourceMode;
+    std::optional<DISPLAYCONFIG_TARGET_MODE> TargetMode;
+};
+
+static std::optional<DisplayPath> FindDisplayPathForMonitor(HMONITOR monitor)
+{
+    MONITORINFOEXW monitorInfo = {};
+    monitorInfo.cbSize = sizeof(monitorInfo);
+    if (!GetMonitorInfoW(monitor, &monitorInfo))
+    {
+        return std::nullopt;
+    }
+
+    std::vector<DISPLAYCONFIG_PATH_INFO> paths;
+    std::vector<DISPLAYCONFIG_MODE_INFO> modes;
+    LONG result = ERROR_SUCCESS;
+    do
+    {
+        // The configuration can change between the two calls
+        UINT32 pathCount = 0;
+        UINT32 modeCount = 0;
+        if (GetDisplayConfigBufferSizes(QDC_ONLY_ACTIVE_PATHS, &pathCount, &modeCount) != ERROR_SUCCESS)
+        {
+            return std::nullopt;
+        }
+        paths.resize(pathCount);
+        modes.resize(modeCount);
+        result = QueryDisplayConfig(QDC_ONLY_ACTIVE_PATHS, &pathCount, paths.data(), &modeCount, modes.data(), nullptr);
+        paths.resize(pathCount);
+    } while (result == ERROR_INSUFFICIENT_BUFFER);
+    if (result != ERROR_SUCCESS)
+    {
+        return std::nullopt;
+    }
+
+    for (auto&& path : paths)
+    {
+        DISPLAYCONFIG_SOURCE_DEVICE_NAME sourceName = {};
+        sourceName.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SOURCE_NAME;
+        sourceName.header.size = sizeof(sourceName);
+        sourceName.header.adapterId = path.sourceInfo.adapterId;
+        sourceName.header.id = path.sourceInfo.id;
+        if (DisplayConfigGetDeviceInfo(&sourceName.header) != ERROR_SUCCESS)
+        {
+            continue;
+        }
+        if (wcscmp(sourceName.viewGdiDeviceName, monitorInfo.szDevice) == 0)
+        {
+            DisplayPath displayPath = { path };
+            auto sourceModeIndex = path.sourceInfo.modeInfoIdx;
+            if (sourceModeIndex < modes.size() && modes[sourceModeIndex].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE)
+            {
+                displayPath.SourceMode = modes[sourceModeIndex].sourceMode;
+            }
+            auto targetModeIndex = path.targetInfo.modeInfoIdx;
+            if (targetModeIndex < modes.size() && modes[targetModeIndex].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_TARGET)
+            {
+                displayPath.TargetMode = modes[targetModeIndex].targetMode;
+            }
+            return displayPath;
+        }
+    }
+    return std::nullopt;
+}
+
+static double RationalToDouble(DISPLAYCONFIG_RATIONAL const& rational)
+{
+    if (rational.Denominator == 0)
+    {
+        return 0.0;
+    }
+    return static_cast<double>(rational.Numerator) / static_cast<double>(rational.Denominator);
+}
+
+std::optional<DisplayMode> GetMonitorDisplayMode(HMONITOR monitor)
+{
+    auto path = FindDisplayPathForMonitor(monitor);
+    if (!path.has_value())
+    {
+        return std::nullopt;
+    }
+    auto refreshRate = RationalToDouble(path->Path.targetInfo.refreshRate);
+    if (refreshRate <= 0.0)
+    {
+        return std::nullopt;
+    }
+    DisplayMode mode = {};
+    mode.RefreshRate = refreshRate;
+    if (path->SourceMode.has_value())
+    {
+        mode.Width = path->SourceMode->width;
+        mode.Height = path->SourceMode->height;
+    }
+    if (path->TargetMode.has_value())
+    {
+        mode.SignalRefreshRate = RationalToDouble(path->TargetMode->targetVideoSignalInfo.vSyncFreq);
+    }
+    return mode;
+}
+
+std::optional<OutputCapabilities> GetMonitorOutputCapabilities(HMONITOR monitor)
+{
+    auto output = FindOutputForMonitor(monitor);
+    if (output == nullptr)
+    {
+        return std::nullopt;
+    }
+    OutputCapabilities capabilities = {};
+    // Each of these needs a newer DXGI, anything missing counts as unsupported
+    if (auto output2 = output.try_as<IDXGIOutput2>())
+    {
+        capabilities.Overlays = output2->SupportsOverlays() != FALSE;
+    }
+    if (auto output6 = output.try_as<IDXGIOutput6>())
+    {
+        UINT flags = 0;
+        if (SUCCEEDED(output6->CheckHardwareCompositionSupport(&flags)))
+        {
+            capabilities.WindowedHardwareComposition = (flags & DXGI_HARDWARE_COMPOSITION_SUPPORT_FLAG_WINDOWED) != 0;
+        }
+    }
+    auto factory = winrt::capture<IDXGIFactory1>(CreateDXGIFactory1);
+    if (auto factory5 = factory.try_as<IDXGIFactory5>())
+    {
+        BOOL allowTearing = FALSE;
+        if (SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))))
+        {
+            capabilities.Tearing = allowTearing != FALSE;
+        }
+    }
+    return capabilities;
+}
+
+winrt::com_ptr<IDXGIOutput> FindOutputForMonitor(HMONITOR monitor)
+{
+    auto factory = winrt::capture<IDXGIFactory1>(CreateDXGIFactory1);
+    winrt::com_ptr<IDXGIAdapter1> adapter;
+    for (UINT adapterIndex = 0; factory->EnumAdapters1(adapterIndex, adapter.put()) != DXGI_ERROR_NOT_FOUND; adapterIndex++)
+    {
+        winrt::com_ptr<IDXGIOutput> output;
+        for (UINT outputIndex = 0; adapter->EnumOutputs(outputIndex, output.put()) != DXGI_ERROR_NOT_FOUND; outputIndex++)
+        {
+            DXGI_OUTPUT_DESC desc = {};
+            winrt::check_hresult(output->GetDesc(&desc));
+            if (desc.Monitor == monitor)
+            {
+                return output;
+            }
+            output = nullptr;
+        }
+        adapter = nullptr;
+    }
+    return nullptr;
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+// The current mode of the monitor's active display path, from QueryDisplayConfig
+struct DisplayMode
+{
+    uint32_t Width;
+    uint32_t Height;
+    // What the desktop is composed at
+    double RefreshRate;
+    // Of the signal sent to the monitor, zero if unknown. Can differ from
+    // RefreshRate, e.g. with dynamic refresh rate.
+    double SignalRefreshRate;
+};
+
+// What the output supports that changes how the DWM presents, from DXGI
+struct OutputCapabilities
+{
+    // Hardware overlay planes (MPO), windows promoted to one are scanned out
+    // without being composed into the desktop
+    bool Overlays;
+    // Windowed swap chains can be scanned out without the DWM composing them
+    bool WindowedHardwareComposition;
+    // Tearing presents, which variable refresh needs, are allowed. This is
+    // system wide rather than per output.
+    bool Tearing;
+};
+
+std::optional<DisplayMode> GetMonitorDisplayMode(HMONITOR monitor);
+std::optional<OutputCapabilities> GetMonitorOutputCapabilities(HMONITOR monitor);
+// nullptr if no adapter has an output for the monitor
+winrt::com_ptr<IDXGIOutput> FindOutputForMonitor(HMONITOR monitor);
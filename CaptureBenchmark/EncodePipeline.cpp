@@ -0,0 +1,484 @@
+﻿#include "pch.h"
+#include "EncodePipeline.h"
+#include "Timing.h"
+
+PipelineWorkload::PipelineWorkload(winrt::com_ptr<ID3D11Device> const& device, PipelineOptions const& options) : GpuFrameWorkload(device), m_options(options)
+{
+    if (m_options.Depth == 0)
+    {
+        throw winrt::hresult_invalid_argument(L"The pipeline needs at least one surface.");
+    }
+    winrt::check_hresult(MFStartup(MF_VERSION));
+
+    // The encoder uses the device from its own threads
+    auto multithread = m_device.as<ID3D10Multithread>();
+    multithread->SetMultithreadProtected(TRUE);
+
+    UINT resetToken = 0;
+    winrt::check_hresult(MFCreateDXGIDeviceManager(&resetToken, m_deviceManager.put()));
+    winrt::check_hresult(m_deviceManager->ResetDevice(m_device.get(), resetToken));
+
+    m_videoDevice = m_device.as<ID3D11VideoDevice>();
+    m_videoContext = m_context.as<ID3D11VideoContext>();
+}
+
+PipelineWorkload::~PipelineWorkload()
+{
+    try
+    {
+        Finish();
+    }
+    catch (...)
+    {
+    }
+    m_surfaces.clear();
+    m_inputViews.clear();
+    m_events = nullptr;
+    m_encoder = nullptr;
+    m_deviceManager = nullptr;
+    MFShutdown();
+}
+
+void PipelineWorkload::Prepare(winrt::Windows::Graphics::SizeInt32 size, DXGI_FORMAT format)
+{
+    // NV12 needs even dimensions
+    m_width = std::max<uint32_t>(static_cast<uint32_t>(size.Width) & ~1u, 2);
+    m_height = std::max<uint32_t>(static_cast<uint32_t>(size.Height) & ~1u, 2);
+    CreateVideoProcessor(format);
+    CreateSurfaces();
+    CreateEncoder();
+    m_eventThread = std::thread([this]() { RunEvents(); });
+}
+
+void PipelineWorkload::CreateVideoProcessor(DXGI_FORMAT format)
+{
+    D3D11_VIDEO_PROCESSOR_CONTENT_DESC contentDesc = {};
+    contentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+    contentDesc.InputFrameRate = { FramesPerSecondHint, 1 };
+    contentDesc.InputWidth = m_width;
+    contentDesc.InputHeight = m_height;
+    contentDesc.OutputFrameRate = { FramesPerSecondHint, 1 };
+    contentDesc.OutputWidth = m_width;
+    contentDesc.OutputHeight = m_height;
+    contentDesc.Usage = D3D11_VIDEO_USAGE_OPTIMAL_SPEED;
+    winrt::check_hresult(m_videoDevice->CreateVideoProcessorEnumerator(&contentDesc, m_processorEnumerator.put()));
+
+    UINT inputSupport = 0;
+    winrt::check_hresult(m_processorEnumerator->CheckVideoProcessorFormat(format, &inputSupport));
+    UINT outputSupport = 0;
+    winrt::check_hresult(m_processorEnumerator->CheckVideoProcessorFormat(DXGI_FORMAT_NV12, &outputSupport));
+    if ((inputSupport & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_INPUT) == 0 || (outputSupport & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT) == 0)
+    {
+        throw winrt::hresult_error(E_NOTIMPL, L"The video processor can't convert the capture format to NV12.");
+    }
+    winrt::check_hresult(m_videoDevice->CreateVideoProcessor(m_processorEnumerator.get(), 0, m_processor.put()));
+
+    // Full range RGB in, studio range BT.709 out, which is what encoders expect
+    D3D11_VIDEO_PROCESSOR_COLOR_SPACE inputColorSpace = {};
+    inputColorSpace.RGB_Range = 0;
+    D3D11_VIDEO_PROCESSOR_COLOR_SPACE outputColorSpace = {};
+    outputColorSpace.YCbCr_Matrix = 1;
+    outputColorSpace.Nominal_Range = D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_16_235;
+    m_videoContext->VideoProcessorSetStreamColorSpace(m_processor.get(), 0, &inputColorSpace);
+    m_videoContext->VideoProcessorSetOutputColorSpace(m_processor.get(), &outputColorSpace);
+    m_videoContext->VideoProcessorSetStreamFrameFormat(m_processor.get(), 0, D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE);
+    // Keeps driver enhancements out of the conversion time
+    m_videoContext->VideoProcessorSetStreamAutoProcessingMode(m_processor.get(), 0, FALSE);
+}
+
+void PipelineWorkload::CreateSurfaces()
+{
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = m_width;
+    desc.Height = m_height;
+    desc.Format = DXGI_FORMAT_NV12;
+    desc.ArraySize = 1;
+    desc.MipLevels = 1;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+    D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC viewDesc = {};
+    viewDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
+
+    m_surfaces.resize(m_options.Depth);
+    for (auto&& surface : m_surfaces)
+    {
+        winrt::check_hresult(m_device->CreateTexture2D(&desc, nullptr, surface.Texture.put()));
+        winrt::check_hresult(m_videoDevice->CreateVideoProcessorOutputView(surface.Texture.get(), m_processorEnumerator.get(), &viewDesc, surface.OutputView.put()));
+
+        winrt::com_ptr<IMFMediaBuffer> buffer;
+        winrt::check_hresult(MFCreateDXGISurfaceBuffer(__uuidof(ID3D11Texture2D), surface.Texture.get(), 0, FALSE, buffer.put()));
+        DWORD length = 0;
+        winrt::check_hresult(buffer.as<IMF2DBuffer>()->GetContiguousLength(&length));
+        winrt::check_hresult(buffer->SetCurrentLength(length));
+        winrt::check_hresult(MFCreateSample(surface.Sample.put()));
+        winrt::check_hresult(surface.Sample->AddBuffer(buffer.get()));
+    }
+}
+
+void PipelineWorkload::CreateEncoder()
+{
+    // The encoder has to be on the capture device's adapter, otherwise
+    // every frame is copied between GPUs
+    winrt::com_ptr<IDXGIAdapter> adapter;
+    winrt::check_hresult(m_device.as<IDXGIDevice>()->GetAdapter(adapter.put()));
+    DXGI_ADAPTER_DESC adapterDesc = {};
+    winrt::check_hresult(adapter->GetDesc(&adapterDesc));
+    winrt::com_ptr<IMFAttributes> enumAttributes;
+    winrt::check_hresult(MFCreateAttributes(enumAttributes.put(), 1));
+    winrt::check_hresult(enumAttributes->SetBlob(MFT_ENUM_ADAPTER_LUID, reinterpret_cast<UINT8 const*>(&adapterDesc.AdapterLuid), sizeof(adapterDesc.AdapterLuid)));
+
+    auto subtype = m_options.Codec == VideoCodec::Hevc ? MFVideoFormat_HEVC : MFVideoFormat_H264;
+    MFT_REGISTER_TYPE_INFO outputInfo = { MFMediaType_Video, subtype };
+    IMFActivate** activates = nullptr;
+    UINT32 activateCount = 0;
+    winrt::check_hresult(MFTEnum2(
+        MFT_CATEGORY_VIDEO_ENCODER,
+        MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER,
+        nullptr,
+        &outputInfo,
+        enumAttributes.get(),
+        &activates,
+        &activateCount));
+    std::vector<winrt::com_ptr<IMFActivate>> encoders;
+    for (UINT32 index = 0; index < activateCount; index++)
+    {
+        encoders.push_back(winrt::com_ptr<IMFActivate>(activates[index], winrt::take_ownership_from_abi));
+    }
+    CoTaskMemFree(activates);
+    if (encoders.empty())
+    {
+        throw winrt::hresult_error(MF_E_TOPO_CODEC_NOT_FOUND, L"No hardware encoder for the codec on the capture adapter.");
+    }
+    winrt::check_hresult(encoders.front()->ActivateObject(IID_PPV_ARGS(m_encoder.put())));
+
+    // Hardware encoders are asynchronous, and locked until we say we know it
+    winrt::com_ptr<IMFAttributes> attributes;
+    winrt::check_hresult(m_encoder->GetAttributes(attributes.put()));
+    UINT32 async = FALSE;
+    if (FAILED(attributes->GetUINT32(MF_TRANSFORM_ASYNC, &async)) || !async)
+    {
+        throw winrt::hresult_error(MF_E_UNSUPPORTED_CHARACTERISTICS, L"The hardware encoder isn't asynchronous.");
+    }
+    winrt::check_hresult(attributes->SetUINT32(MF_TRANSFORM_ASYNC_UNLOCK, TRUE));
+    m_events = m_encoder.as<IMFMediaEventGenerator>();
+
+    auto hr = m_encoder->GetStreamIDs(1, &m_inputStreamId, 1, &m_outputStreamId);
+    if (hr == E_NOTIMPL)
+    {
+        m_inputStreamId = 0;
+        m_outputStreamId = 0;
+    }
+    else
+    {
+        winrt::check_hresult(hr);
+    }
+
+    winrt::check_hresult(m_encoder->ProcessMessage(MFT_MESSAGE_SET_D3D_MANAGER, reinterpret_cast<ULONG_PTR>(m_deviceManager.get())));
+
+    // Without reordering each input comes back out as it went in, which is
+    // what lets us match outputs to surfaces
+    if (auto codecApi = m_encoder.try_as<ICodecAPI>())
+    {
+        VARIANT lowLatency = {};
+        lowLatency.vt = VT_BOOL;
+        lowLatency.boolVal = VARIANT_TRUE;
+        codecApi->SetValue(&CODECAPI_AVLowLatencyMode, &lowLatency);
+    }
+
+    // Encoders want the output type before the input type
+    winrt::com_ptr<IMFMediaType> outputType;
+    winrt::check_hresult(MFCreateMediaType(outputType.put()));
+    winrt::check_hresult(outputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    winrt::check_hresult(outputType->SetGUID(MF_MT_SUBTYPE, subtype));
+    winrt::check_hresult(outputType->SetUINT32(MF_MT_AVG_BITRATE, BitrateInBitsPerSecond));
+    winrt::check_hresult(outputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    winrt::check_hresult(MFSetAttributeSize(outputType.get(), MF_MT_FRAME_SIZE, m_width, m_height));
+    winrt::check_hresult(MFSetAttributeRatio(outputType.get(), MF_MT_FRAME_RATE, FramesPerSecondHint, 1));
+    winrt::check_hresult(MFSetAttributeRatio(outputType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+    winrt::check_hresult(m_encoder->SetOutputType(m_outputStreamId, outputType.get(), 0));
+
+    winrt::com_ptr<IMFMediaType> inputType;
+    for (DWORD typeIndex = 0;; typeIndex++)
+    {
+        winrt::com_ptr<IMFMediaType> availableType;
+        hr = m_encoder->GetInputAvailableType(m_inputStreamId, typeIndex, availableType.put());
+        if (hr == MF_E_NO_MORE_TYPES)
+        {
+            break;
+        }
+        winrt::check_hresult(hr);
+        GUID availableSubtype = {};
+        if (SUCCEEDED(availableType->GetGUID(MF_MT_SUBTYPE, &availableSubtype)) && availableSubtype == MFVideoFormat_NV12)
+        {
+            inputType = availableType;
+            break;
+        }
+    }
+    if (inputType == nullptr)
+    {
+        throw winrt::hresult_error(MF_E_INVALIDMEDIATYPE, L"The hardware encoder doesn't take NV12.");
+    }
+    winrt::check_hresult(MFSetAttributeSize(inputType.get(), MF_MT_FRAME_SIZE, m_width, m_height));
+    winrt::check_hresult(MFSetAttributeRatio(inputType.get(), MF_MT_FRAME_RATE, FramesPerSecondHint, 1));
+    winrt::check_hresult(m_encoder->SetInputType(m_inputStreamId, inputType.get(), 0));
+
+    winrt::check_hresult(m_encoder->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0));
+    winrt::check_hresult(m_encoder->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0));
+}
+
+winrt::com_ptr<ID3D11VideoProcessorInputView> PipelineWorkload::GetInputView(ID3D11Texture2D* texture)
+{
+    for (auto&& [cachedTexture, view] : m_inputViews)
+    {
+        if (cachedTexture.get() == texture)
+        {
+            return view;
+        }
+    }
+    // A recreated pool brings new buffers, the old ones won't come back
+    if (m_inputViews.size() >= MaxInputViews)
+    {
+        m_inputViews.clear();
+    }
+    D3D11_VIDEO_PROCESSOR_INPUT_VIEW_DESC viewDesc = {};
+    viewDesc.ViewDimension = D3D11_VPIV_DIMENSION_TEXTURE2D;
+    winrt::com_ptr<ID3D11VideoProcessorInputView> view;
+    winrt::check_hresult(m_videoDevice->CreateVideoProcessorInputView(texture, m_processorEnumerator.get(), &viewDesc, view.put()));
+    winrt::com_ptr<ID3D11Texture2D> heldTexture;
+    heldTexture.copy_from(texture);
+    m_inputViews.push_back({ heldTexture, view });
+    return view;
+}
+
+WorkloadResult PipelineWorkload::Process(WorkloadFrame const& frame)
+{
+    WorkloadResult result = {};
+    if (m_finished || m_encoder == nullptr)
+    {
+        result.Dropped = true;
+        return result;
+    }
+
+    auto waitStartQpc = GetQpcNow();
+    size_t surfaceIndex = 0;
+    {
+        std::unique_lock lock(m_lock);
+        result.Encoded.swap(m_encoded);
+        auto findFree = [&]() { return std::find_if(m_surfaces.begin(), m_surfaces.end(), [](auto&& surface) { return !surface.InUse; }); };
+        result.SurfaceStalled = findFree() == m_surfaces.end();
+        // The captured frame is held while we wait, this is where the
+        // encoder pushes back on the frame pool
+        auto ready = m_condition.wait_for(lock, SurfaceTimeout, [&]() { return m_failed || findFree() != m_surfaces.end(); });
+        if (!ready || m_failed)
+        {
+            result.Dropped = true;
+            return result;
+        }
+        auto surface = findFree();
+        surface->InUse = true;
+        surfaceIndex = static_cast<size_t>(surface - m_surfaces.begin());
+        result.SurfacesInFlight = static_cast<uint32_t>(std::count_if(m_surfaces.begin(), m_surfaces.end(), [](auto&& surface) { return surface.InUse; }));
+    }
+    result.SurfaceWaitQpc = GetQpcNow() - waitStartQpc;
+
+    // Only Process touches a surface between picking and queuing it
+    auto& surface = m_surfaces[surfaceIndex];
+    auto inputView = GetInputView(frame.Texture);
+    // The encoder size is fixed, convert whatever part of the content fits
+    RECT rect = {};
+    rect.right = static_cast<LONG>(std::min<uint32_t>(m_width, static_cast<uint32_t>(frame.ContentSize.Width)));
+    rect.bottom = static_cast<LONG>(std::min<uint32_t>(m_height, static_cast<uint32_t>(frame.ContentSize.Height)));
+    m_videoContext->VideoProcessorSetStreamSourceRect(m_processor.get(), 0, TRUE, &rect);
+    m_videoContext->VideoProcessorSetStreamDestRect(m_processor.get(), 0, TRUE, &rect);
+    D3D11_VIDEO_PROCESSOR_STREAM stream = {};
+    stream.Enable = TRUE;
+    stream.pInputSurface = inputView.get();
+    BeginGpuWork();
+    winrt::check_hresult(m_videoContext->VideoProcessorBlt(m_processor.get(), surface.OutputView.get(), 0, 1, &stream));
+    // The frame is released after we return, so the conversion has to be
+    // done. The encode is asynchronous and isn't part of the GPU timing.
+    auto gpuResult = GetGpuResult(WaitForGpu());
+    result.GpuStartQpc = gpuResult.GpuStartQpc;
+    result.GpuDurationQpc = gpuResult.GpuDurationQpc;
+
+    if (m_firstTimestamp < 0)
+    {
+        m_firstTimestamp = frame.SystemRelativeTime;
+    }
+    auto sampleTime = frame.SystemRelativeTime - m_firstTimestamp;
+    winrt::check_hresult(surface.Sample->SetSampleTime(sampleTime));
+    winrt::check_hresult(surface.Sample->SetSampleDuration(HundredNanosecondsPerSecond / FramesPerSecondHint));
+
+    std::scoped_lock lock(m_lock);
+    surface.SampleTime = sampleTime;
+    surface.SystemRelativeTime = frame.SystemRelativeTime;
+    surface.ConvertedQpc = GetQpcNow();
+    surface.InputStalled = m_inputRequests == 0 || !m_pending.empty();
+    m_pending.push_back(surfaceIndex);
+    SubmitPending();
+    return result;
+}
+
+void PipelineWorkload::SubmitPending()
+{
+    while (m_inputRequests > 0 && !m_pending.empty())
+    {
+        auto& surface = m_surfaces[m_pending.front()];
+        m_pending.pop_front();
+        m_inputRequests--;
+        surface.Submitted = true;
+        surface.SubmittedQpc = GetQpcNow();
+        winrt::check_hresult(m_encoder->ProcessInput(m_inputStreamId, surface.Sample.get(), 0));
+        // Finish waits for the queue to empty before draining
+        if (m_pending.empty())
+        {
+            m_condition.notify_all();
+        }
+    }
+}
+
+void PipelineWorkload::RunEvents()
+{
+    try
+    {
+        while (true)
+        {
+            // Blocks until the encoder has something for us, fails once
+            // it has been shut down
+            winrt::com_ptr<IMFMediaEvent> event;
+            winrt::check_hresult(m_events->GetEvent(0, event.put()));
+            MediaEventType type = MEUnknown;
+            winrt::check_hresult(event->GetType(&type));
+            HRESULT status = S_OK;
+            winrt::check_hresult(event->GetStatus(&status));
+            winrt::check_hresult(status);
+            if (type == METransformNeedInput)
+            {
+                std::scoped_lock lock(m_lock);
+                m_inputRequests++;
+                SubmitPending();
+            }
+            else if (type == METransformHaveOutput)
+            {
+                OnHaveOutput();
+            }
+            else if (type == METransformDrainComplete)
+            {
+                std::scoped_lock lock(m_lock);
+                m_drained = true;
+                m_condition.notify_all();
+                return;
+            }
+        }
+    }
+    catch (...)
+    {
+        // Frames are dropped from here on rather than waiting on an
+        // encoder that won't return their surfaces
+        std::scoped_lock lock(m_lock);
+        m_failed = true;
+        m_condition.notify_all();
+    }
+}
+
+void PipelineWorkload::OnHaveOutput()
+{
+    MFT_OUTPUT_STREAM_INFO streamInfo = {};
+    winrt::check_hresult(m_encoder->GetOutputStreamInfo(m_outputStreamId, &streamInfo));
+    MFT_OUTPUT_DATA_BUFFER output = {};
+    output.dwStreamID = m_outputStreamId;
+    winrt::com_ptr<IMFSample> sample;
+    auto providesSamples = (streamInfo.dwFlags & (MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES)) != 0;
+    if (!providesSamples)
+    {
+        winrt::com_ptr<IMFMediaBuffer> buffer;
+        winrt::check_hresult(MFCreateMemoryBuffer(streamInfo.cbSize, buffer.put()));
+        winrt::check_hresult(MFCreateSample(sample.put()));
+        winrt::check_hresult(sample->AddBuffer(buffer.get()));
+        output.pSample = sample.get();
+    }
+    DWORD status = 0;
+    auto hr = m_encoder->ProcessOutput(0, 1, &output, &status);
+    if (providesSamples && output.pSample != nullptr)
+    {
+        sample.attach(output.pSample);
+    }
+    if (output.pEvents != nullptr)
+    {
+        output.pEvents->Release();
+    }
+    if (hr == MF_E_TRANSFORM_STREAM_CHANGE)
+    {
+        // Some encoders settle on their real output type once they start
+        winrt::com_ptr<IMFMediaType> outputType;
+        winrt::check_hresult(m_encoder->GetOutputAvailableType(m_outputStreamId, 0, outputType.put()));
+        winrt::check_hresult(m_encoder->SetOutputType(m_outputStreamId, outputType.get(), 0));
+        return;
+    }
+    winrt::check_hresult(hr);
+    auto outputQpc = GetQpcNow();
+    LONGLONG sampleTime = 0;
+    winrt::check_hresult(sample->GetSampleTime(&sampleTime));
+    DWORD bytes = 0;
+    winrt::check_hresult(sample->GetTotalLength(&bytes));
+
+    std::scoped_lock lock(m_lock);
+    for (auto&& surface : m_surfaces)
+    {
+        // Nothing is reordered, so anything submitted up to this sample is
+        // done, even if the encoder dropped it
+        if (!surface.Submitted || surface.SampleTime > sampleTime)
+        {
+            continue;
+        }
+        if (surface.SampleTime == sampleTime)
+        {
+            EncodedFrameTiming timing = {};
+            timing.InputWaitQpc = surface.SubmittedQpc - surface.ConvertedQpc;
+            timing.InputStalled = surface.InputStalled;
+            timing.EncodeQpc = outputQpc - surface.SubmittedQpc;
+            timing.EndToEndQpc = outputQpc - HundredNanosecondsToQpc(surface.SystemRelativeTime);
+            timing.Bytes = bytes;
+            m_encoded.push_back(timing);
+        }
+        surface.Submitted = false;
+        surface.InUse = false;
+    }
+    m_condition.notify_all();
+}
+
+void PipelineWorkload::Finish()
+{
+    if (m_finished)
+    {
+        return;
+    }
+    m_finished = true;
+    if (m_encoder == nullptr)
+    {
+        return;
+    }
+
+    // Whatever is still queued goes in before the drain
+    {
+        std::unique_lock lock(m_lock);
+        m_condition.wait_for(lock, DrainTimeout, [&]() { return m_failed || m_pending.empty(); });
+    }
+    if (SUCCEEDED(m_encoder->ProcessMessage(MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0)) &&
+        SUCCEEDED(m_encoder->ProcessMessage(MFT_MESSAGE_COMMAND_DRAIN, 0)))
+    {
+        std::unique_lock lock(m_lock);
+        m_condition.wait_for(lock, DrainTimeout, [&]() { return m_failed || m_drained; });
+    }
+    // Also wakes the event thread if the drain never completed
+    if (auto shutdown = m_encoder.try_as<IMFShutdown>())
+    {
+        shutdown->Shutdown();
+    }
+    if (m_eventThread.joinable())
+    {
+        m_eventThread.join();
+    }
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include "FrameWorkload.h"
+
+// The production path, captured frame -> NV12 -> hardware encoder. Each
+// frame is converted with an ID3D11VideoProcessor into one of Depth NV12
+// surfaces and queued for an asynchronous encoder MFT, which asks for input
+// and hands back output through events pumped on a thread of our own. A
+// surface is reused once the encoder has output its frame, so when the
+// encoder falls behind Process waits for one while still holding the
+// captured frame, and the frame pool feels it. The bitstream is discarded.
+class PipelineWorkload : public GpuFrameWorkload
+{
+public:
+    PipelineWorkload(winrt::com_ptr<ID3D11Device> const& device, PipelineOptions const& options);
+    ~PipelineWorkload() override;
+
+    void Prepare(winrt::Windows::Graphics::SizeInt32 size, DXGI_FORMAT format) override;
+    WorkloadResult Process(WorkloadFrame const& frame) override;
+    void Finish() override;
+
+private:
+    struct Surface
+    {
+        winrt::com_ptr<ID3D11Texture2D> Texture;
+        winrt::com_ptr<ID3D11VideoProcessorOutputView> OutputView;
+        winrt::com_ptr<IMFSample> Sample;
+        // From being picked by Process until the encoder outputs it
+        bool InUse = false;
+        bool Submitted = false;
+        bool InputStalled = false;
+        int64_t SampleTime = 0;
+        int64_t SystemRelativeTime = 0;
+        int64_t ConvertedQpc = 0;
+        int64_t SubmittedQpc = 0;
+    };
+
+    void CreateVideoProcessor(DXGI_FORMAT format);
+    void CreateSurfaces();
+    void CreateEncoder();
+    winrt::com_ptr<ID3D11VideoProcessorInputView> GetInputView(ID3D11Texture2D* texture);
+    void RunEvents();
+    void OnHaveOutput();
+    // Feeds converted surfaces to the encoder for as much input as it has
+    // asked for. Expects m_lock to be held.
+    void SubmitPending();
+
+private:
+    static constexpr uint32_t FramesPerSecondHint = 60;
+    static constexpr uint32_t BitrateInBitsPerSecond = 20'000'000;
+    // Longer than any sane encode, so a wedged encoder drops frames instead
+    // of hanging the capture thread
+    static constexpr std::chrono::seconds SurfaceTimeout{ 1 };
+    static constexpr std::chrono::seconds DrainTimeout{ 5 };
+    static constexpr size_t MaxInputViews = 8;
+
+    PipelineOptions m_options;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    winrt::com_ptr<IMFDXGIDeviceManager> m_deviceManager;
+    winrt::com_ptr<ID3D11VideoDevice> m_videoDevice;
+    winrt::com_ptr<ID3D11VideoContext> m_videoContext;
+    winrt::com_ptr<ID3D11VideoProcessorEnumerator> m_processorEnumerator;
+    winrt::com_ptr<ID3D11VideoProcessor> m_processor;
+    // The frame pool reuses its buffers, so their views can be too. Holding
+    // the texture keeps its address from being reused by another one.
+    std::vector<std::pair<winrt::com_ptr<ID3D11Texture2D>, winrt::com_ptr<ID3D11VideoProcessorInputView>>> m_inputViews;
+    winrt::com_ptr<IMFTransform> m_encoder;
+    winrt::com_ptr<IMFMediaEventGenerator> m_events;
+    DWORD m_inputStreamId = 0;
+    DWORD m_outputStreamId = 0;
+    std::thread m_eventThread;
+    int64_t m_firstTimestamp = -1;
+    bool m_finished = false;
+
+    // Guards everything below, shared with the event thread
+    std::mutex m_lock;
+    std::condition_variable m_condition;
+    std::vector<Surface> m_surfaces;
+    // Converted, waiting for the encoder to ask for input
+    std::deque<size_t> m_pending;
+    uint32_t m_inputRequests = 0;
+    std::vector<EncodedFrameTiming> m_encoded;
+    bool m_failed = false;
+    bool m_drained = false;
+};
@@ -0,0 +1,136 @@
+﻿#include "pch.h"
+#include "EncodeWorkload.h"
+
+EncodeWorkload::EncodeWorkload(winrt::com_ptr<ID3D11Device> const& device, std::wstring const& outputPath) : GpuFrameWorkload(device), m_outputPath(outputPath)
+{
+    winrt::check_hresult(MFStartup(MF_VERSION));
+
+    // Media Foundation uses the device from its own threads
+    auto multithread = m_device.as<ID3D10Multithread>();
+    multithread->SetMultithreadProtected(TRUE);
+
+    UINT resetToken = 0;
+    winrt::check_hresult(MFCreateDXGIDeviceManager(&resetToken, m_deviceManager.put()));
+    winrt::check_hresult(m_deviceManager->ResetDevice(m_device.get(), resetToken));
+}
+
+EncodeWorkload::~EncodeWorkload()
+{
+    try
+    {
+        Finish();
+    }
+    catch (...)
+    {
+    }
+    m_allocator = nullptr;
+    m_sinkWriter = nullptr;
+    m_deviceManager = nullptr;
+    MFShutdown();
+}
+
+void EncodeWorkload::Initialize(uint32_t width, uint32_t height)
+{
+    // H.264 needs even dimensions
+    m_width = std::max<uint32_t>(width & ~1u, 2);
+    m_height = std::max<uint32_t>(height & ~1u, 2);
+
+    winrt::com_ptr<IMFMediaType> outputType;
+    winrt::check_hresult(MFCreateMediaType(outputType.put()));
+    winrt::check_hresult(outputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    winrt::check_hresult(outputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264));
+    winrt::check_hresult(outputType->SetUINT32(MF_MT_AVG_BITRATE, BitrateInBitsPerSecond));
+    winrt::check_hresult(outputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    winrt::check_hresult(MFSetAttributeSize(outputType.get(), MF_MT_FRAME_SIZE, m_width, m_height));
+    winrt::check_hresult(MFSetAttributeRatio(outputType.get(), MF_MT_FRAME_RATE, FramesPerSecondHint, 1));
+    winrt::check_hresult(MFSetAttributeRatio(outputType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+
+    winrt::com_ptr<IMFMediaType> inputType;
+    winrt::check_hresult(MFCreateMediaType(inputType.put()));
+    winrt::check_hresult(inputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    winrt::check_hresult(inputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_ARGB32));
+    winrt::check_hresult(inputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    winrt::check_hresult(MFSetAttributeSize(inputType.get(), MF_MT_FRAME_SIZE, m_width, m_height));
+    winrt::check_hresult(MFSetAttributeRatio(inputType.get(), MF_MT_FRAME_RATE, FramesPerSecondHint, 1));
+    winrt::check_hresult(MFSetAttributeRatio(inputType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+
+    winrt::com_ptr<IMFAttributes> writerAttributes;
+    winrt::check_hresult(MFCreateAttributes(writerAttributes.put(), 2));
+    winrt::check_hresult(writerAttributes->SetUnknown(MF_SINK_WRITER_D3D_MANAGER, m_deviceManager.get()));
+    winrt::check_hresult(writerAttributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE));
+    winrt::check_hresult(MFCreateSinkWriterFromURL(m_outputPath.c_str(), nullptr, writerAttributes.get(), m_sinkWriter.put()));
+    winrt::check_hresult(m_sinkWriter->AddStream(outputType.get(), &m_streamIndex));
+    winrt::check_hresult(m_sinkWriter->SetInputMediaType(m_streamIndex, inputType.get(), nullptr));
+    winrt::check_hresult(m_sinkWriter->BeginWriting());
+
+    winrt::com_ptr<IMFAttributes> allocatorAttributes;
+    winrt::check_hresult(MFCreateAttributes(allocatorAttributes.put(), 2));
+    winrt::check_hresult(allocatorAttributes->SetUINT32(MF_SA_D3D11_BINDFLAGS, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE));
+    winrt::check_hresult(allocatorAttributes->SetUINT32(MF_SA_D3D11_USAGE, D3D11_USAGE_DEFAULT));
+    winrt::check_hresult(MFCreateVideoSampleAllocatorEx(IID_PPV_ARGS(m_allocator.put())));
+    winrt::check_hresult(m_allocator->SetDirectXManager(m_deviceManager.get()));
+    winrt::check_hresult(m_allocator->InitializeSampleAllocatorEx(2, MaxSamplesInFlight, allocatorAttributes.get(), inputType.get()));
+}
+
+WorkloadResult EncodeWorkload::Process(WorkloadFrame const& frame)
+{
+    if (m_finished)
+    {
+        return { true };
+    }
+    if (m_sinkWriter == nullptr)
+    {
+        Initialize(static_cast<uint32_t>(frame.ContentSize.Width), static_cast<uint32_t>(frame.ContentSize.Height));
+    }
+
+    winrt::com_ptr<IMFSample> sample;
+    auto hr = m_allocator->AllocateSample(sample.put());
+    if (hr == MF_E_SAMPLEALLOCATOR_EMPTY)
+    {
+        return { true };
+    }
+    winrt::check_hresult(hr);
+
+    winrt::com_ptr<IMFMediaBuffer> buffer;
+    winrt::check_hresult(sample->GetBufferByIndex(0, buffer.put()));
+    auto dxgiBuffer = buffer.as<IMFDXGIBuffer>();
+    winrt::com_ptr<ID3D11Texture2D> texture;
+    winrt::check_hresult(dxgiBuffer->GetResource(IID_PPV_ARGS(texture.put())));
+    UINT subresource = 0;
+    winrt::check_hresult(dxgiBuffer->GetSubresourceIndex(&subresource));
+
+    // The encoder size is fixed, copy whatever part of the content fits
+    D3D11_BOX box = {};
+    box.right = std::min<uint32_t>(m_width, static_cast<uint32_t>(frame.ContentSize.Width));
+    box.bottom = std::min<uint32_t>(m_height, static_cast<uint32_t>(frame.ContentSize.Height));
+    box.back = 1;
+    BeginGpuWork();
+    m_context->CopySubresourceRegion(texture.get(), subresource, 0, 0, 0, frame.Texture, 0, &box);
+    // The frame is released after we return, so the copy has to be done.
+    // The encode itself is asynchronous and isn't part of the GPU timing.
+    auto result = GetGpuResult(WaitForGpu());
+
+    if (m_firstTimestamp < 0)
+    {
+        m_firstTimestamp = frame.SystemRelativeTime;
+    }
+    auto duration = m_lastTimestamp < 0 ? (10'000'000 / FramesPerSecondHint) : (frame.SystemRelativeTime - m_lastTimestamp);
+    m_lastTimestamp = frame.SystemRelativeTime;
+    winrt::check_hresult(sample->SetSampleTime(frame.SystemRelativeTime - m_firstTimestamp));
+    winrt::check_hresult(sample->SetSampleDuration(duration));
+    winrt::check_hresult(m_sinkWriter->WriteSample(m_streamIndex, sample.get()));
+    return result;
+}
+
+void EncodeWorkload::Finish()
+{
+    if (m_finished)
+    {
+        return;
+    }
+    m_finished = true;
+    if (m_sinkWriter != nullptr)
+    {
+        winrt::check_hresult(m_sinkWriter->Finalize());
+    }
+}
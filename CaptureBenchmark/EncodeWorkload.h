@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "FrameWorkload.h"
+
+// Encodes frames to an H.264 mp4 with a Media Foundation sink writer,
+// preferring a hardware encoder. Frames are copied into samples from a
+// D3D11 sample allocator; when the encoder hasn't returned any samples
+// yet the frame is dropped instead of stalling the capture thread.
+class EncodeWorkload : public GpuFrameWorkload
+{
+public:
+    EncodeWorkload(winrt::com_ptr<ID3D11Device> const& device, std::wstring const& outputPath);
+    ~EncodeWorkload() override;
+
+    WorkloadResult Process(WorkloadFrame const& frame) override;
+    void Finish() override;
+
+private:
+    void Initialize(uint32_t width, uint32_t height);
+
+private:
+    static constexpr uint32_t FramesPerSecondHint = 60;
+    static constexpr uint32_t BitrateInBitsPerSecond = 20'000'000;
+    static constexpr DWORD MaxSamplesInFlight = 8;
+
+    std::wstring m_outputPath;
+    winrt::com_ptr<IMFDXGIDeviceManager> m_deviceManager;
+    winrt::com_ptr<IMFSinkWriter> m_sinkWriter;
+    winrt::com_ptr<IMFVideoSampleAllocatorEx> m_allocator;
+    DWORD m_streamIndex = 0;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    int64_t m_firstTimestamp = -1;
+    int64_t m_lastTimestamp = -1;
+    bool m_finished = false;
+};
@@ -0,0 +1,228 @@
+﻿#include "pch.h"
+#include "Enumeration.h"
+#include "Adapters.h"
+#include "Timing.h"
+
+namespace util
+{
+    using namespace robmikh::common::desktop;
+}
+
+static std::mutex s_monitorDetailsLock;
+static std::vector<std::pair<HMONITOR, MonitorDetails>> s_monitorDetails;
+
+static MonitorDetails QueryMonitorDetails(HMONITOR monitor)
+{
+    MonitorDetails details = {};
+    details.Mode = GetMonitorDisplayMode(monitor);
+    if (details.Mode.has_value())
+    {
+        details.RefreshRate = details.Mode->RefreshRate;
+    }
+    details.AdapterLuid = GetMonitorAdapterLuid(monitor);
+    details.Capabilities = GetMonitorOutputCapabilities(monitor);
+    return details;
+}
+
+static void CacheMonitorDetails(HMONITOR monitor, MonitorDetails const& details)
+{
+    std::scoped_lock lock(s_monitorDetailsLock);
+    for (auto&& [cachedMonitor, cachedDetails] : s_monitorDetails)
+    {
+        if (cachedMonitor == monitor)
+        {
+            cachedDetails = details;
+            return;
+        }
+    }
+    s_monitorDetails.push_back({ monitor, details });
+}
+
+MonitorDetails GetMonitorDetails(HMONITOR monitor)
+{
+    {
+        std::scoped_lock lock(s_monitorDetailsLock);
+        for (auto&& [cachedMonitor, cachedDetails] : s_monitorDetails)
+        {
+            if (cachedMonitor == monitor)
+            {
+                return cachedDetails;
+            }
+        }
+    }
+    auto details = QueryMonitorDetails(monitor);
+    CacheMonitorDetails(monitor, details);
+    return details;
+}
+
+static std::vector<MonitorEntry> EnumerateMonitorEntries()
+{
+    std::vector<HMONITOR> monitors;
+    winrt::check_bool(EnumDisplayMonitors(nullptr, nullptr, [](HMONITOR hmon, HDC, LPRECT, LPARAM lparam)
+        {
+            auto& monitors = *reinterpret_cast<std::vector<HMONITOR>*>(lparam);
+            monitors.push_back(hmon);
+
+            return TRUE;
+        }, reinterpret_cast<LPARAM>(&monitors)));
+
+    std::vector<MonitorEntry> entries;
+    for (auto&& monitor : monitors)
+    {
+        MonitorEntry entry = {};
+        entry.Index = static_cast<uint32_t>(entries.size());
+        entry.Monitor = monitor;
+        MONITORINFOEXW monitorInfo = {};
+        monitorInfo.cbSize = sizeof(monitorInfo);
+        if (GetMonitorInfoW(monitor, &monitorInfo))
+        {
+            entry.DeviceName = monitorInfo.szDevice;
+            entry.Bounds = monitorInfo.rcMonitor;
+            entry.Primary = (monitorInfo.dwFlags & MONITORINFOF_PRIMARY) != 0;
+        }
+        entry.Details = QueryMonitorDetails(monitor);
+        CacheMonitorDetails(monitor, entry.Details);
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+static std::wstring GetProcessName(DWORD processId)
+{
+    wil::unique_handle process(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId));
+    if (!process)
+    {
+        return L"";
+    }
+    std::array<wchar_t, MAX_PATH> path = {};
+    auto length = static_cast<DWORD>(path.size());
+    if (!QueryFullProcessImageNameW(process.get(), 0, path.data(), &length))
+    {
+        return L"";
+    }
+    std::wstring name(path.data(), length);
+    auto separator = name.find_last_of(L'\\');
+    return separator != std::wstring::npos ? name.substr(separator + 1) : name;
+}
+
+static std::vector<WindowEntry> EnumerateWindowEntries()
+{
+    // An empty query matches every capturable window
+    auto windows = util::FindTopLevelWindowsByTitle(L"");
+    // Most processes own several windows
+    std::vector<std::pair<DWORD, std::wstring>> processNames;
+    std::vector<WindowEntry> entries;
+    for (auto&& window : windows)
+    {
+        WindowEntry entry = {};
+        entry.Window = window.WindowHandle;
+        entry.Title = window.Title;
+        GetWindowThreadProcessId(window.WindowHandle, &entry.ProcessId);
+        auto cachedName = std::find_if(processNames.begin(), processNames.end(), [&](auto const& pair) { return pair.first == entry.ProcessId; });
+        if (cachedName != processNames.end())
+        {
+            entry.ProcessName = cachedName->second;
+        }
+        else
+        {
+            entry.ProcessName = GetProcessName(entry.ProcessId);
+            processNames.push_back({ entry.ProcessId, entry.ProcessName });
+        }
+        entry.Monitor = MonitorFromWindow(window.WindowHandle, MONITOR_DEFAULTTONEAREST);
+        if (FAILED(DwmGetWindowAttribute(window.WindowHandle, DWMWA_EXTENDED_FRAME_BOUNDS, &entry.Bounds, sizeof(entry.Bounds))))
+        {
+            GetWindowRect(window.WindowHandle, &entry.Bounds);
+        }
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+EnumerationSnapshot TakeEnumerationSnapshot()
+{
+    auto startQpc = GetQpcNow();
+    // QueryDisplayConfig and the DXGI output walk are the slow part, and
+    // don't depend on the windows
+    auto monitors = std::async(std::launch::async, EnumerateMonitorEntries);
+    EnumerationSnapshot snapshot = {};
+    snapshot.Windows = EnumerateWindowEntries();
+    snapshot.Monitors = monitors.get();
+    snapshot.DurationQpc = GetQpcNow() - startQpc;
+    return snapshot;
+}
+
+std::vector<WindowEntry> FindWindowsInSnapshot(EnumerationSnapshot const& snapshot, std::wstring const& titleQuery, std::optional<DWORD> processId)
+{
+    std::vector<WindowEntry> windows;
+    for (auto&& window : snapshot.Windows)
+    {
+        if (processId.has_value() && window.ProcessId != processId.value())
+        {
+            continue;
+        }
+        if (window.Title.find(titleQuery) == std::wstring::npos)
+        {
+            continue;
+        }
+        windows.push_back(window);
+    }
+    return windows;
+}
+
+std::optional<uint32_t> FindMonitorIndexInSnapshot(EnumerationSnapshot const& snapshot, HMONITOR monitor)
+{
+    for (auto&& entry : snapshot.Monitors)
+    {
+        if (entry.Monitor == monitor)
+        {
+            return entry.Index;
+        }
+    }
+    return std::nullopt;
+}
+
+void PrintEnumerationSnapshot(EnumerationSnapshot const& snapshot)
+{
+    wprintf(L"Monitors:\n");
+    wprintf(L"  %-5s %-12s %-14s %-10s %-10s %-5s %-8s %-20s %s\n", L"Index", L"Device", L"Size", L"Refresh", L"Signal", L"MPO", L"Tearing", L"Adapter", L"");
+    for (auto&& monitor : snapshot.Monitors)
+    {
+        auto const& details = monitor.Details;
+        auto size = std::to_wstring(monitor.Bounds.right - monitor.Bounds.left) + L"x" + std::to_wstring(monitor.Bounds.bottom - monitor.Bounds.top);
+        auto refreshRate = details.RefreshRate.has_value() ? std::to_wstring(std::lround(details.RefreshRate.value())) + L" Hz" : L"-";
+        auto signalRefreshRate = details.Mode.has_value() && details.Mode->SignalRefreshRate > 0.0 ? std::to_wstring(std::lround(details.Mode->SignalRefreshRate)) + L" Hz" : L"-";
+        auto overlays = details.Capabilities.has_value() ? (details.Capabilities->Overlays ? L"yes" : L"no") : L"-";
+        auto tearing = details.Capabilities.has_value() ? (details.Capabilities->Tearing ? L"yes" : L"no") : L"-";
+        auto adapter = details.AdapterLuid.has_value() ? FormatLuid(details.AdapterLuid.value()) : L"-";
+        wprintf(L"  %-5u %-12s %-14s %-10s %-10s %-5s %-8s %-20s %s\n",
+            monitor.Index,
+            monitor.DeviceName.c_str(),
+            size.c_str(),
+            refreshRate.c_str(),
+            signalRefreshRate.c_str(),
+            overlays,
+            tearing,
+            adapter.c_str(),
+            monitor.Primary ? L"primary" : L"");
+    }
+
+    wprintf(L"\n");
+    wprintf(L"Windows:\n");
+    wprintf(L"  %-18s %-8s %-24s %-12s %-7s %s\n", L"HWND", L"PID", L"Process", L"Size", L"Monitor", L"Title");
+    for (auto&& window : snapshot.Windows)
+    {
+        auto size = std::to_wstring(window.Bounds.right - window.Bounds.left) + L"x" + std::to_wstring(window.Bounds.bottom - window.Bounds.top);
+        auto monitorIndex = FindMonitorIndexInSnapshot(snapshot, window.Monitor);
+        auto monitor = monitorIndex.has_value() ? std::to_wstring(monitorIndex.value()) : L"-";
+        wprintf(L"  0x%016I64x %-8u %-24s %-12s %-7s %s\n",
+            reinterpret_cast<uint64_t>(window.Window),
+            window.ProcessId,
+            window.ProcessName.c_str(),
+            size.c_str(),
+            monitor.c_str(),
+            window.Title.c_str());
+    }
+
+    wprintf(L"\n");
+    wprintf(L"Enumerated %zu monitors and %zu windows in %.1f ms\n", snapshot.Monitors.size(), snapshot.Windows.size(), QpcToSeconds(snapshot.DurationQpc) * 1000.0);
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+#include "DisplayInfo.h"
+
+// What a session needs to know about the monitor it captures from
+struct MonitorDetails
+{
+    // Same as the mode's, kept separate since most callers only need this
+    std::optional<double> RefreshRate;
+    // The adapter driving the monitor, if DXGI knows about it
+    std::optional<LUID> AdapterLuid;
+    std::optional<DisplayMode> Mode;
+    std::optional<OutputCapabilities> Capabilities;
+};
+
+struct MonitorEntry
+{
+    // Position in EnumDisplayMonitors order, used by '-monitor'
+    uint32_t Index;
+    HMONITOR Monitor;
+    std::wstring DeviceName;
+    RECT Bounds;
+    bool Primary;
+    MonitorDetails Details;
+};
+
+struct WindowEntry
+{
+    HWND Window;
+    std::wstring Title;
+    DWORD ProcessId;
+    std::wstring ProcessName;
+    // The monitor the window is mostly on
+    HMONITOR Monitor;
+    // Visible bounds without the drop shadow
+    RECT Bounds;
+};
+
+// Capturable top-level windows and monitors, collected once so that
+// creating sessions repeatedly measures capture startup and not
+// enumeration. Monitors are enumerated on another thread while the windows
+// are walked.
+struct EnumerationSnapshot
+{
+    std::vector<MonitorEntry> Monitors;
+    std::vector<WindowEntry> Windows;
+    int64_t DurationQpc;
+};
+
+EnumerationSnapshot TakeEnumerationSnapshot();
+// Windows whose title contains the query, optionally owned by a process
+std::vector<WindowEntry> FindWindowsInSnapshot(EnumerationSnapshot const& snapshot, std::wstring const& titleQuery, std::optional<DWORD> processId);
+std::optional<uint32_t> FindMonitorIndexInSnapshot(EnumerationSnapshot const& snapshot, HMONITOR monitor);
+void PrintEnumerationSnapshot(EnumerationSnapshot const& snapshot);
+
+// Cached per monitor for the life of the process, and filled in by
+// TakeEnumerationSnapshot. Looked up on a miss.
+MonitorDetails GetMonitorDetails(HMONITOR monitor);
@@ -0,0 +1,89 @@
+﻿#include "pch.h"
+#include "FrameCounterReader.h"
+#include "ContentGenerator.h"
+#include "PixelFormat.h"
+
+constexpr int32_t CounterWidth = CounterTilesPerRow * CounterTileSize;
+constexpr int32_t CounterHeight = ((CounterBits + CounterTilesPerRow - 1) / CounterTilesPerRow) * CounterTileSize;
+
+FrameCounterReader::FrameCounterReader(winrt::com_ptr<ID3D11Device> const& device, DXGI_FORMAT format)
+{
+    m_device = device;
+    m_device->GetImmediateContext(m_context.put());
+    m_format = format;
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = static_cast<uint32_t>(CounterWidth);
+    desc.Height = static_cast<uint32_t>(CounterHeight);
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = format;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    winrt::check_hresult(m_device->CreateTexture2D(&desc, nullptr, m_stagingTexture.put()));
+}
+
+std::optional<uint32_t> FrameCounterReader::Read(ID3D11Texture2D* texture, winrt::Windows::Graphics::SizeInt32 contentSize)
+{
+    if (contentSize.Width < CounterMargin + CounterWidth || contentSize.Height < CounterMargin + CounterHeight)
+    {
+        return std::nullopt;
+    }
+
+    D3D11_BOX box = {};
+    box.left = static_cast<uint32_t>(CounterMargin);
+    box.top = static_cast<uint32_t>(CounterMargin);
+    box.right = box.left + static_cast<uint32_t>(CounterWidth);
+    box.bottom = box.top + static_cast<uint32_t>(CounterHeight);
+    box.back = 1;
+    m_context->CopySubresourceRegion(m_stagingTexture.get(), 0, 0, 0, 0, texture, 0, &box);
+
+    // The copy is tiny, waiting on it is cheaper than pipelining it
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    winrt::check_hresult(m_context->Map(m_stagingTexture.get(), 0, D3D11_MAP_READ, 0, &mapped));
+    auto bytes = reinterpret_cast<uint8_t const*>(mapped.pData);
+    auto bytesPerPixel = GetBytesPerPixel(m_format);
+    std::optional<uint32_t> counter = 0;
+    for (int32_t bit = 0; bit < CounterBits; bit++)
+    {
+        // Sample the middle of each tile, away from any filtering at the edges
+        auto x = ((bit % CounterTilesPerRow) * CounterTileSize) + (CounterTileSize / 2);
+        auto y = ((bit / CounterTilesPerRow) * CounterTileSize) + (CounterTileSize / 2);
+        auto value = ReadBit(bytes + (static_cast<size_t>(y) * mapped.RowPitch) + (static_cast<size_t>(x) * bytesPerPixel));
+        if (value < 0)
+        {
+            counter = std::nullopt;
+            break;
+        }
+        counter = counter.value() | (static_cast<uint32_t>(value) << bit);
+    }
+    m_context->Unmap(m_stagingTexture.get(), 0);
+    return counter;
+}
+
+int32_t FrameCounterReader::ReadBit(uint8_t const* pixel) const
+{
+    if (m_format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+    {
+        // Positive halfs compare like integers. White can be brighter than
+        // 1.0 depending on the SDR white level.
+        uint16_t green = 0;
+        memcpy(&green, pixel + 2, sizeof(green));
+        if (green & 0x8000)
+        {
+            return -1;
+        }
+        if (green < 0x3400)
+        {
+            return 0;
+        }
+        return green > 0x3A00 ? 1 : -1;
+    }
+    auto green = pixel[1];
+    if (green < 64)
+    {
+        return 0;
+    }
+    return green > 191 ? 1 : -1;
+}
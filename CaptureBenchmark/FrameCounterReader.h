@@ -0,0 +1,23 @@
+﻿#pragma once
+
+// Reads back the frame counter drawn by ContentGenerator. Only the tiles are
+// copied out of each frame, into a small staging texture.
+class FrameCounterReader
+{
+public:
+    FrameCounterReader(winrt::com_ptr<ID3D11Device> const& device, DXGI_FORMAT format);
+
+    // Empty if the frame is too small to hold the counter or the tiles
+    // aren't clearly black or white, e.g. something covers the window
+    std::optional<uint32_t> Read(ID3D11Texture2D* texture, winrt::Windows::Graphics::SizeInt32 contentSize);
+
+private:
+    // 0 or 1, -1 if the tile is neither
+    int32_t ReadBit(uint8_t const* pixel) const;
+
+private:
+    winrt::com_ptr<ID3D11Device> m_device;
+    winrt::com_ptr<ID3D11DeviceContext> m_context;
+    winrt::com_ptr<ID3D11Texture2D> m_stagingTexture;
+    DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+};
@@ -0,0 +1,61 @@
+﻿#include "pch.h"
+#include "FrameWorkerPool.h"
+
+FrameWorkerPool::FrameWorkerPool(uint32_t workerCount, uint32_t queueCapacity, FrameHandler const& handler) : m_handler(handler), m_queue(queueCapacity)
+{
+    if (workerCount == 0 || queueCapacity == 0)
+    {
+        throw winrt::hresult_invalid_argument(L"The worker pool needs at least one worker and one queue slot.");
+    }
+    m_available.reset(CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr));
+    winrt::check_bool(m_available.is_valid());
+    for (uint32_t workerIndex = 0; workerIndex < workerCount; workerIndex++)
+    {
+        m_threads.emplace_back([this, workerIndex]() { Run(workerIndex); });
+    }
+}
+
+FrameWorkerPool::~FrameWorkerPool()
+{
+    Stop([](auto& frame) { frame.Frame.Close(); });
+}
+
+bool FrameWorkerPool::TryEnqueue(QueuedFrame& frame)
+{
+    if (!m_queue.TryPush(frame))
+    {
+        return false;
+    }
+    winrt::check_bool(ReleaseSemaphore(m_available.get(), 1, nullptr));
+    return true;
+}
+
+void FrameWorkerPool::Stop(std::function<void(QueuedFrame&)> const& discard)
+{
+    m_stopEvent.SetEvent();
+    for (auto&& thread : m_threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    QueuedFrame frame;
+    while (m_queue.TryPop(frame))
+    {
+        discard(frame);
+    }
+}
+
+void FrameWorkerPool::Run(uint32_t workerIndex)
+{
+    HANDLE handles[] = { m_stopEvent.get(), m_available.get() };
+    while (WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+    {
+        QueuedFrame frame;
+        if (m_queue.TryPop(frame))
+        {
+            m_handler(workerIndex, frame);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+#include "BoundedQueue.h"
+#include "ResultsSink.h"
+
+struct QueuedFrame
+{
+    winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame Frame{ nullptr };
+    winrt::com_ptr<ID3D11Texture2D> Texture;
+    FrameRecord Record = {};
+    int64_t EnqueueQpc = 0;
+};
+
+// Hands frames from FrameArrived to a fixed set of worker threads through a
+// bounded queue, the way a production consumer would spread the work.
+class FrameWorkerPool
+{
+public:
+    typedef std::function<void(uint32_t workerIndex, QueuedFrame& frame)> FrameHandler;
+
+    FrameWorkerPool(uint32_t workerCount, uint32_t queueCapacity, FrameHandler const& handler);
+    ~FrameWorkerPool();
+    FrameWorkerPool(FrameWorkerPool const&) = delete;
+    FrameWorkerPool& operator=(FrameWorkerPool const&) = delete;
+
+    // Single producer only. Returns false and leaves the frame with the
+    // caller when every slot is taken.
+    bool TryEnqueue(QueuedFrame& frame);
+    size_t Depth() const { return m_queue.Size(); }
+    // Waits for the workers to finish the frame they're on. Anything still
+    // queued is handed to discard instead.
+    void Stop(std::function<void(QueuedFrame&)> const& discard);
+
+private:
+    void Run(uint32_t workerIndex);
+
+private:
+    FrameHandler m_handler;
+    BoundedQueue<QueuedFrame> m_queue;
+    // Released once per queued frame
+    wil::unique_handle m_available;
+    wil::unique_event m_stopEvent{ wil::EventOptions::ManualReset };
+    std::vector<std::thread> m_threads;
+};
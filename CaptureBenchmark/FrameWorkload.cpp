@@ -0,0 +1,332 @@
+﻿#include "pch.h"
+#include "FrameWorkload.h"
+#include "EncodePipeline.h"
+#include "EncodeWorkload.h"
+#include "PixelFormat.h"
+#include "Timing.h"
+
+// Inverts the frame, enough to touch every pixel once
+static const char ComputeShaderSource[] = R"(
+Texture2D<float4> Input : register(t0);
+RWTexture2D<float4> Output : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    float4 color = Input[id.xy];
+    Output[id.xy] = float4(1.0f - color.rgb, color.a);
+}
+)";
+
+GpuFrameWorkload::GpuFrameWorkload(winrt::com_ptr<ID3D11Device> const& device) : m_device(device)
+{
+    m_device->GetImmediateContext(m_context.put());
+    D3D11_QUERY_DESC queryDesc = {};
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    winrt::check_hresult(m_device->CreateQuery(&queryDesc, m_query.put()));
+
+    queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    winrt::check_hresult(m_device->CreateQuery(&queryDesc, m_disjointQuery.put()));
+    queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+    winrt::check_hresult(m_device->CreateQuery(&queryDesc, m_gpuStartQuery.put()));
+    winrt::check_hresult(m_device->CreateQuery(&queryDesc, m_gpuEndQuery.put()));
+}
+
+void GpuFrameWorkload::BeginGpuWork()
+{
+    m_context->Begin(m_disjointQuery.get());
+    m_context->End(m_gpuStartQuery.get());
+    m_gpuWorkOpen = true;
+}
+
+void GpuFrameWorkload::EndGpuWork()
+{
+    if (!m_gpuWorkOpen)
+    {
+        return;
+    }
+    m_context->End(m_gpuEndQuery.get());
+    m_context->End(m_disjointQuery.get());
+    m_gpuWorkOpen = false;
+    m_gpuWorkPending = true;
+}
+
+int64_t GpuFrameWorkload::WaitForGpu()
+{
+    EndGpuWork();
+    m_context->End(m_query.get());
+    BOOL done = FALSE;
+    while (m_context->GetData(m_query.get(), &done, sizeof(done), 0) == S_FALSE)
+    {
+        YieldProcessor();
+    }
+    return GetQpcNow();
+}
+
+template <typename T>
+static T GetQueryData(ID3D11DeviceContext* context, ID3D11Query* query)
+{
+    T data = {};
+    while (context->GetData(query, &data, sizeof(data), 0) == S_FALSE)
+    {
+        YieldProcessor();
+    }
+    return data;
+}
+
+WorkloadResult GpuFrameWorkload::GetGpuResult(int64_t completedQpc)
+{
+    WorkloadResult result = {};
+    if (!m_gpuWorkPending)
+    {
+        return result;
+    }
+    m_gpuWorkPending = false;
+
+    auto disjoint = GetQueryData<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(m_context.get(), m_disjointQuery.get());
+    auto gpuStart = GetQueryData<uint64_t>(m_context.get(), m_gpuStartQuery.get());
+    auto gpuEnd = GetQueryData<uint64_t>(m_context.get(), m_gpuEndQuery.get());
+    // The GPU clock changed frequency part way through, the values are useless
+    if (disjoint.Disjoint || disjoint.Frequency == 0 || gpuEnd < gpuStart)
+    {
+        return result;
+    }
+    auto durationQpc = static_cast<int64_t>((static_cast<double>(gpuEnd - gpuStart) * GetQpcFrequency()) / disjoint.Frequency);
+    result.GpuDurationQpc = durationQpc;
+    result.GpuStartQpc = completedQpc - durationQpc;
+    return result;
+}
+
+void GpuFrameWorkload::EnsureTexture(winrt::com_ptr<ID3D11Texture2D>& texture, D3D11_TEXTURE2D_DESC const& frameDesc, D3D11_USAGE usage, UINT bindFlags, UINT cpuAccessFlags)
+{
+    if (texture != nullptr)
+    {
+        D3D11_TEXTURE2D_DESC existingDesc = {};
+        texture->GetDesc(&existingDesc);
+        if (existingDesc.Width == frameDesc.Width &&
+            existingDesc.Height == frameDesc.Height &&
+            existingDesc.Format == frameDesc.Format)
+        {
+            return;
+        }
+        texture = nullptr;
+    }
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = frameDesc.Width;
+    desc.Height = frameDesc.Height;
+    desc.Format = frameDesc.Format;
+    desc.ArraySize = 1;
+    desc.MipLevels = 1;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = usage;
+    desc.BindFlags = bindFlags;
+    desc.CPUAccessFlags = cpuAccessFlags;
+    winrt::check_hresult(m_device->CreateTexture2D(&desc, nullptr, texture.put()));
+}
+
+WorkloadResult CopyWorkload::Process(WorkloadFrame const& frame)
+{
+    D3D11_TEXTURE2D_DESC frameDesc = {};
+    frame.Texture->GetDesc(&frameDesc);
+    EnsureTexture(m_texture, frameDesc, D3D11_USAGE_DEFAULT, 0, 0);
+
+    BeginGpuWork();
+    m_context->CopyResource(m_texture.get(), frame.Texture);
+    return GetGpuResult(WaitForGpu());
+}
+
+void ReadbackWorkload::Prepare(winrt::Windows::Graphics::SizeInt32 size, DXGI_FORMAT format)
+{
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = static_cast<uint32_t>(size.Width);
+    desc.Height = static_cast<uint32_t>(size.Height);
+    desc.Format = format;
+    EnsureSlots(desc);
+}
+
+void ReadbackWorkload::EnsureSlots(D3D11_TEXTURE2D_DESC const& frameDesc)
+{
+    if (m_slots.empty())
+    {
+        m_slots.resize(SlotCount);
+        for (auto&& slot : m_slots)
+        {
+            D3D11_QUERY_DESC queryDesc = {};
+            queryDesc.Query = D3D11_QUERY_EVENT;
+            winrt::check_hresult(m_device->CreateQuery(&queryDesc, slot.CopyDone.put()));
+        }
+    }
+    for (auto&& slot : m_slots)
+    {
+        auto previousTexture = slot.Texture.get();
+        EnsureTexture(slot.Texture, frameDesc, D3D11_USAGE_STAGING, 0, D3D11_CPU_ACCESS_READ);
+        if (slot.Texture.get() != previousTexture)
+        {
+            // Whatever was in flight was for the old size
+            slot.Pending = false;
+        }
+    }
+}
+
+int64_t ReadbackWorkload::ReadSlot(Slot& slot)
+{
+    // The copy finished before the frame was released, so this doesn't wait
+    auto startQpc = GetQpcNow();
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    winrt::check_hresult(m_context->Map(slot.Texture.get(), 0, D3D11_MAP_READ, 0, &mapped));
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    slot.Texture->GetDesc(&desc);
+    auto width = std::min<uint32_t>(static_cast<uint32_t>(slot.ContentSize.Width), desc.Width);
+    auto height = std::min<uint32_t>(static_cast<uint32_t>(slot.ContentSize.Height), desc.Height);
+    auto rowBytes = width * GetBytesPerPixel(desc.Format);
+    m_bytes.resize(static_cast<size_t>(rowBytes) * height);
+    auto source = reinterpret_cast<uint8_t const*>(mapped.pData);
+    for (uint32_t row = 0; row < height; row++)
+    {
+        memcpy(m_bytes.data() + (static_cast<size_t>(row) * rowBytes), source + (static_cast<size_t>(row) * mapped.RowPitch), rowBytes);
+    }
+    m_context->Unmap(slot.Texture.get(), 0);
+    slot.Pending = false;
+    return GetQpcNow() - startQpc;
+}
+
+WorkloadResult ReadbackWorkload::Process(WorkloadFrame const& frame)
+{
+    D3D11_TEXTURE2D_DESC frameDesc = {};
+    frame.Texture->GetDesc(&frameDesc);
+    EnsureSlots(frameDesc);
+
+    // Only the slot being reused is read back, the others hold newer frames
+    auto& slot = m_slots[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+    std::optional<int64_t> readQpc;
+    if (slot.Pending)
+    {
+        readQpc = ReadSlot(slot);
+    }
+
+    auto copyStartQpc = GetQpcNow();
+    BeginGpuWork();
+    m_context->CopyResource(slot.Texture.get(), frame.Texture);
+    EndGpuWork();
+    m_context->End(slot.CopyDone.get());
+    m_context->Flush();
+    slot.Pending = true;
+    slot.ContentSize = frame.ContentSize;
+
+    // The frame can't be released until the GPU is done reading it
+    BOOL done = FALSE;
+    while (m_context->GetData(slot.CopyDone.get(), &done, sizeof(done), 0) == S_FALSE)
+    {
+        YieldProcessor();
+    }
+
+    auto completedQpc = GetQpcNow();
+    auto result = GetGpuResult(completedQpc);
+    result.CopyQpc = completedQpc - copyStartQpc;
+    result.ReadQpc = readQpc;
+    return result;
+}
+
+void ReadbackWorkload::Finish()
+{
+    for (auto&& slot : m_slots)
+    {
+        if (slot.Pending)
+        {
+            ReadSlot(slot);
+        }
+    }
+}
+
+ComputeWorkload::ComputeWorkload(winrt::com_ptr<ID3D11Device> const& device) : GpuFrameWorkload(device)
+{
+    winrt::com_ptr<ID3DBlob> shaderBlob;
+    winrt::com_ptr<ID3DBlob> errorBlob;
+    auto hr = D3DCompile(
+        ComputeShaderSource,
+        sizeof(ComputeShaderSource) - 1,
+        "ComputeWorkload",
+        nullptr,
+        nullptr,
+        "main",
+        "cs_5_0",
+        D3DCOMPILE_OPTIMIZATION_LEVEL3,
+        0,
+        shaderBlob.put(),
+        errorBlob.put());
+    if (FAILED(hr))
+    {
+        if (errorBlob != nullptr)
+        {
+            wprintf(L"Compute shader compilation failed: %S\n", reinterpret_cast<char const*>(errorBlob->GetBufferPointer()));
+        }
+        winrt::throw_hresult(hr);
+    }
+    winrt::check_hresult(m_device->CreateComputeShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, m_shader.put()));
+}
+
+WorkloadResult ComputeWorkload::Process(WorkloadFrame const& frame)
+{
+    D3D11_TEXTURE2D_DESC frameDesc = {};
+    frame.Texture->GetDesc(&frameDesc);
+    // Typed UAV stores aren't supported for BGRA
+    auto outputDesc = frameDesc;
+    if (outputDesc.Format == DXGI_FORMAT_B8G8R8A8_UNORM)
+    {
+        outputDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+    auto previousTexture = m_outputTexture.get();
+    EnsureTexture(m_outputTexture, outputDesc, D3D11_USAGE_DEFAULT, D3D11_BIND_UNORDERED_ACCESS, 0);
+    if (m_outputTexture.get() != previousTexture || m_outputView == nullptr)
+    {
+        m_outputView = nullptr;
+        winrt::check_hresult(m_device->CreateUnorderedAccessView(m_outputTexture.get(), nullptr, m_outputView.put()));
+    }
+
+    // Frame surfaces get recycled by the pool, a view per frame is cheap
+    // compared to tracking which buffer we're looking at
+    winrt::com_ptr<ID3D11ShaderResourceView> inputView;
+    winrt::check_hresult(m_device->CreateShaderResourceView(frame.Texture, nullptr, inputView.put()));
+
+    ID3D11ShaderResourceView* inputViews[] = { inputView.get() };
+    ID3D11UnorderedAccessView* outputViews[] = { m_outputView.get() };
+    BeginGpuWork();
+    m_context->CSSetShader(m_shader.get(), nullptr, 0);
+    m_context->CSSetShaderResources(0, ARRAYSIZE(inputViews), inputViews);
+    m_context->CSSetUnorderedAccessViews(0, ARRAYSIZE(outputViews), outputViews, nullptr);
+    m_context->Dispatch((frameDesc.Width + 7) / 8, (frameDesc.Height + 7) / 8, 1);
+
+    ID3D11ShaderResourceView* nullInputViews[] = { nullptr };
+    ID3D11UnorderedAccessView* nullOutputViews[] = { nullptr };
+    m_context->CSSetShaderResources(0, ARRAYSIZE(nullInputViews), nullInputViews);
+    m_context->CSSetUnorderedAccessViews(0, ARRAYSIZE(nullOutputViews), nullOutputViews, nullptr);
+    return GetGpuResult(WaitForGpu());
+}
+
+std::unique_ptr<FrameWorkload> CreateFrameWorkload(
+    WorkloadKind kind,
+    winrt::com_ptr<ID3D11Device> const& device,
+    std::wstring const& encodeOutputPath,
+    PipelineOptions const& pipelineOptions)
+{
+    switch (kind)
+    {
+    case WorkloadKind::None:
+        return nullptr;
+    case WorkloadKind::Copy:
+        return std::make_unique<CopyWorkload>(device);
+    case WorkloadKind::Readback:
+        return std::make_unique<ReadbackWorkload>(device);
+    case WorkloadKind::Compute:
+        return std::make_unique<ComputeWorkload>(device);
+    case WorkloadKind::Encode:
+        return std::make_unique<EncodeWorkload>(device, encodeOutputPath);
+    case WorkloadKind::Pipeline:
+        return std::make_unique<PipelineWorkload>(device, pipelineOptions);
+    default:
+        throw winrt::hresult_invalid_argument();
+    }
+}
@@ -0,0 +1,181 @@
+﻿#pragma once
+
+enum class WorkloadKind
+{
+    None,
+    // CopyResource into a default texture
+    Copy,
+    // CopyResource into a ring of staging textures, waited on before the
+    // frame is released and read on the CPU a few frames later
+    Readback,
+    // A compute shader pass reading the frame and writing a UAV
+    Compute,
+    // Media Foundation H.264 encode to a file
+    Encode,
+    // ID3D11VideoProcessor conversion to NV12 feeding an asynchronous
+    // hardware encoder MFT, with a bounded number of frames in flight
+    Pipeline,
+};
+
+enum class VideoCodec
+{
+    H264,
+    Hevc,
+};
+
+// Pipeline workload only
+struct PipelineOptions
+{
+    VideoCodec Codec = VideoCodec::H264;
+    // NV12 surfaces, so frames that can be converted but not yet encoded
+    uint32_t Depth = 3;
+};
+
+// Pipeline workload only, in QPC ticks, for a frame the encoder finished
+struct EncodedFrameTiming
+{
+    // From the conversion finishing to ProcessInput, and whether the
+    // encoder hadn't asked for input yet
+    int64_t InputWaitQpc;
+    bool InputStalled;
+    // From ProcessInput to the encoded sample
+    int64_t EncodeQpc;
+    // From SystemRelativeTime to the encoded sample
+    int64_t EndToEndQpc;
+    uint64_t Bytes;
+};
+
+struct WorkloadFrame
+{
+    ID3D11Texture2D* Texture;
+    winrt::Windows::Graphics::SizeInt32 ContentSize;
+    // 100ns units
+    int64_t SystemRelativeTime;
+};
+
+struct WorkloadResult
+{
+    // The workload couldn't take the frame
+    bool Dropped = false;
+    // Readback only, in QPC ticks. The copy of this frame, and mapping and
+    // copying out whichever earlier frame was read during this call.
+    std::optional<int64_t> CopyQpc;
+    std::optional<int64_t> ReadQpc;
+    // From timestamp queries around the GPU work, converted to QPC ticks.
+    // The start is estimated by subtracting the duration from when we saw
+    // the work complete, D3D11 has no way to calibrate the two clocks.
+    std::optional<int64_t> GpuStartQpc;
+    std::optional<int64_t> GpuDurationQpc;
+    // Pipeline only. How long this frame waited for a free NV12 surface,
+    // whether none was free when it arrived, and how many were in use
+    // once it had one.
+    std::optional<int64_t> SurfaceWaitQpc;
+    bool SurfaceStalled = false;
+    std::optional<uint32_t> SurfacesInFlight;
+    // Pipeline only, frames the encoder finished since the last call
+    std::vector<EncodedFrameTiming> Encoded;
+};
+
+// Work done on each frame in the FrameArrived handler before it is held,
+// standing in for what a real consumer would do with the frame. Process
+// returns once the GPU is done reading the frame, so it can be released
+// afterwards.
+class FrameWorkload
+{
+public:
+    virtual ~FrameWorkload() = default;
+    // Called once the frame pool exists, before any frames arrive
+    virtual void Prepare(winrt::Windows::Graphics::SizeInt32 /*size*/, DXGI_FORMAT /*format*/) {}
+    virtual WorkloadResult Process(WorkloadFrame const& frame) = 0;
+    // Called once capture has stopped
+    virtual void Finish() {}
+};
+
+// Base for workloads that submit GPU work and then wait on it
+class GpuFrameWorkload : public FrameWorkload
+{
+protected:
+    GpuFrameWorkload(winrt::com_ptr<ID3D11Device> const& device);
+    // Brackets the GPU work for a frame with timestamp queries
+    void BeginGpuWork();
+    void EndGpuWork();
+    // Ends the GPU work if needed and returns the QPC it completed at
+    int64_t WaitForGpu();
+    // Only valid once the work is known to be complete
+    WorkloadResult GetGpuResult(int64_t completedQpc);
+    // Recreates the texture when the frame's description changes
+    void EnsureTexture(winrt::com_ptr<ID3D11Texture2D>& texture, D3D11_TEXTURE2D_DESC const& frameDesc, D3D11_USAGE usage, UINT bindFlags, UINT cpuAccessFlags);
+
+protected:
+    winrt::com_ptr<ID3D11Device> m_device;
+    winrt::com_ptr<ID3D11DeviceContext> m_context;
+    winrt::com_ptr<ID3D11Query> m_query;
+    winrt::com_ptr<ID3D11Query> m_disjointQuery;
+    winrt::com_ptr<ID3D11Query> m_gpuStartQuery;
+    winrt::com_ptr<ID3D11Query> m_gpuEndQuery;
+    bool m_gpuWorkOpen = false;
+    bool m_gpuWorkPending = false;
+};
+
+class CopyWorkload : public GpuFrameWorkload
+{
+public:
+    CopyWorkload(winrt::com_ptr<ID3D11Device> const& device) : GpuFrameWorkload(device) {}
+    WorkloadResult Process(WorkloadFrame const& frame) override;
+
+private:
+    winrt::com_ptr<ID3D11Texture2D> m_texture;
+};
+
+// Staging textures are allocated up front so allocation doesn't show up in
+// the measurement. The copy is synchronous: Process waits for it, since the
+// frame is released once Process returns and the workload can't keep it
+// alive. Only the CPU read is deferred, a slot is mapped and copied out when
+// it comes around again SlotCount frames later, so the map never waits on
+// the GPU and there is no stall to report.
+class ReadbackWorkload : public GpuFrameWorkload
+{
+public:
+    ReadbackWorkload(winrt::com_ptr<ID3D11Device> const& device) : GpuFrameWorkload(device) {}
+    void Prepare(winrt::Windows::Graphics::SizeInt32 size, DXGI_FORMAT format) override;
+    WorkloadResult Process(WorkloadFrame const& frame) override;
+    void Finish() override;
+
+private:
+    struct Slot
+    {
+        winrt::com_ptr<ID3D11Texture2D> Texture;
+        winrt::com_ptr<ID3D11Query> CopyDone;
+        bool Pending = false;
+        winrt::Windows::Graphics::SizeInt32 ContentSize = {};
+    };
+
+    void EnsureSlots(D3D11_TEXTURE2D_DESC const& frameDesc);
+    // Returns the time spent mapping and copying out the slot
+    int64_t ReadSlot(Slot& slot);
+
+private:
+    static constexpr size_t SlotCount = 3;
+
+    std::vector<Slot> m_slots;
+    size_t m_nextSlot = 0;
+    std::vector<uint8_t> m_bytes;
+};
+
+class ComputeWorkload : public GpuFrameWorkload
+{
+public:
+    ComputeWorkload(winrt::com_ptr<ID3D11Device> const& device);
+    WorkloadResult Process(WorkloadFrame const& frame) override;
+
+private:
+    winrt::com_ptr<ID3D11ComputeShader> m_shader;
+    winrt::com_ptr<ID3D11Texture2D> m_outputTexture;
+    winrt::com_ptr<ID3D11UnorderedAccessView> m_outputView;
+};
+
+std::unique_ptr<FrameWorkload> CreateFrameWorkload(
+    WorkloadKind kind,
+    winrt::com_ptr<ID3D11Device> const& device,
+    std::wstring const& encodeOutputPath,
+    PipelineOptions const& pipelineOptions = {});
@@ -0,0 +1,141 @@
+﻿#include "pch.h"
+#include "Histogram.h"
+
+static uint32_t HighestSetBit(uint64_t value)
+{
+    // _BitScanReverse64 isn't available on x86, so scan each half
+    unsigned long index = 0;
+    auto high = static_cast<uint32_t>(value >> 32);
+    if (high != 0)
+    {
+        _BitScanReverse(&index, high);
+        return index + 32;
+    }
+    _BitScanReverse(&index, static_cast<uint32_t>(value));
+    return index;
+}
+
+Histogram::Histogram()
+{
+    Reset();
+}
+
+void Histogram::Record(int64_t value)
+{
+    auto clampedValue = static_cast<uint64_t>(std::max<int64_t>(value, 0));
+    m_buckets[BucketIndexForValue(clampedValue)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(clampedValue, std::memory_order_relaxed);
+
+    auto currentMax = m_max.load(std::memory_order_relaxed);
+    while (clampedValue > currentMax && !m_max.compare_exchange_weak(currentMax, clampedValue, std::memory_order_relaxed))
+    {
+    }
+    auto currentMin = m_min.load(std::memory_order_relaxed);
+    while (clampedValue < currentMin && !m_min.compare_exchange_weak(currentMin, clampedValue, std::memory_order_relaxed))
+    {
+    }
+
+    // Publish the count last so readers never see more samples than buckets
+    m_count.fetch_add(1, std::memory_order_release);
+}
+
+void Histogram::Reset()
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(UINT64_MAX, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_release);
+}
+
+void Histogram::Add(Histogram const& other)
+{
+    for (uint32_t i = 0; i < BucketCount; i++)
+    {
+        m_buckets[i].fetch_add(other.m_buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    auto otherMax = other.m_max.load(std::memory_order_relaxed);
+    auto currentMax = m_max.load(std::memory_order_relaxed);
+    while (otherMax > currentMax && !m_max.compare_exchange_weak(currentMax, otherMax, std::memory_order_relaxed))
+    {
+    }
+    auto otherMin = other.m_min.load(std::memory_order_relaxed);
+    auto currentMin = m_min.load(std::memory_order_relaxed);
+    while (otherMin < currentMin && !m_min.compare_exchange_weak(currentMin, otherMin, std::memory_order_relaxed))
+    {
+    }
+
+    m_count.fetch_add(other.m_count.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+uint64_t Histogram::ValueAtPercentile(double percentile) const
+{
+    uint64_t total = 0;
+    for (auto const& bucket : m_buckets)
+    {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    auto target = static_cast<uint64_t>(std::ceil((std::clamp(percentile, 0.0, 100.0) / 100.0) * static_cast<double>(total)));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < BucketCount; i++)
+    {
+        cumulative += m_buckets[i].load(std::memory_order_relaxed);
+        if (cumulative >= target)
+        {
+            return std::min(HighestValueForBucket(i), m_max.load(std::memory_order_relaxed));
+        }
+    }
+    return m_max.load(std::memory_order_relaxed);
+}
+
+HistogramSummary Histogram::Summarize() const
+{
+    HistogramSummary summary = {};
+    summary.Count = m_count.load(std::memory_order_acquire);
+    if (summary.Count == 0)
+    {
+        return summary;
+    }
+    summary.Mean = static_cast<double>(m_sum.load(std::memory_order_relaxed)) / static_cast<double>(summary.Count);
+    summary.Min = m_min.load(std::memory_order_relaxed);
+    summary.P50 = ValueAtPercentile(50.0);
+    summary.P90 = ValueAtPercentile(90.0);
+    summary.P99 = ValueAtPercentile(99.0);
+    summary.Max = m_max.load(std::memory_order_relaxed);
+    return summary;
+}
+
+uint32_t Histogram::BucketIndexForValue(uint64_t value)
+{
+    if (value < SubBucketCount)
+    {
+        return static_cast<uint32_t>(value);
+    }
+    value = std::min<uint64_t>(value, (1ull << MaxValueBits) - 1);
+    auto shift = HighestSetBit(value) - SubBucketBits;
+    auto subBucket = static_cast<uint32_t>(value >> shift) - SubBucketCount;
+    return ((shift + 1) * SubBucketCount) + subBucket;
+}
+
+uint64_t Histogram::HighestValueForBucket(uint32_t index)
+{
+    if (index < SubBucketCount)
+    {
+        return index;
+    }
+    auto shift = (index / SubBucketCount) - 1;
+    auto subBucket = index % SubBucketCount;
+    auto lowest = static_cast<uint64_t>(SubBucketCount + subBucket) << shift;
+    return lowest + (1ull << shift) - 1;
+}
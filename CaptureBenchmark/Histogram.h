@@ -0,0 +1,49 @@
+﻿#pragma once
+
+struct HistogramSummary
+{
+    uint64_t Count;
+    double Mean;
+    uint64_t Min;
+    uint64_t P50;
+    uint64_t P90;
+    uint64_t P99;
+    uint64_t Max;
+};
+
+// A fixed size log-linear histogram (similar to HdrHistogram) that can be
+// recorded into from multiple threads without taking a lock. Values are
+// unitless, callers pick the unit (we use microseconds). Each power of two
+// range is split into 32 sub-buckets, so reported values are within ~3%.
+class Histogram
+{
+public:
+    Histogram();
+    Histogram(Histogram const&) = delete;
+    Histogram& operator=(Histogram const&) = delete;
+
+    void Record(int64_t value);
+    void Reset();
+    // Accumulates another histogram's samples into this one
+    void Add(Histogram const& other);
+
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t ValueAtPercentile(double percentile) const;
+    HistogramSummary Summarize() const;
+
+private:
+    static constexpr uint32_t SubBucketBits = 5;
+    static constexpr uint32_t SubBucketCount = 1 << SubBucketBits;
+    static constexpr uint32_t MaxValueBits = 48;
+    static constexpr uint32_t BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+    static uint32_t BucketIndexForValue(uint64_t value);
+    static uint64_t HighestValueForBucket(uint32_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_min;
+    std::atomic<uint64_t> m_max;
+};
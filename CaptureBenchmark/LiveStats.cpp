@@ -0,0 +1,163 @@
+﻿#include "pch.h"
+#include "LiveStats.h"
+#include "Timing.h"
+
+namespace
+{
+    constexpr size_t LiveStatsSize = sizeof(LiveStatsHeader) + (sizeof(LiveStatsSlot) * LiveStatsSlotCount);
+    static_assert(sizeof(LiveStatsHeader) % alignof(LiveStatsSlot) == 0, "Slots have to start aligned");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Readers in other processes can't share a lock");
+}
+
+SharedMemorySink::SharedMemorySink(std::wstring const& name)
+{
+    m_mapping.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(LiveStatsSize), name.c_str()));
+    winrt::check_bool(m_mapping.is_valid());
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        throw winrt::hresult_error(HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS), L"Live stats are already published under this name.");
+    }
+    m_view.reset(MapViewOfFile(m_mapping.get(), FILE_MAP_WRITE, 0, 0, LiveStatsSize));
+    winrt::check_bool(m_view != nullptr);
+
+    // New mappings are zeroed, so every Sequence starts out unwritten
+    m_header = new (m_view.get()) LiveStatsHeader{};
+    m_header->Magic = LiveStatsMagic;
+    m_header->Version = LiveStatsVersion;
+    m_header->SlotSize = sizeof(LiveStatsSlot);
+    m_header->SlotCount = LiveStatsSlotCount;
+    m_header->QpcFrequency = GetQpcFrequency();
+    m_header->ProcessId = GetCurrentProcessId();
+    m_slots = reinterpret_cast<LiveStatsSlot*>(reinterpret_cast<uint8_t*>(m_view.get()) + sizeof(LiveStatsHeader));
+    m_publishIntervalQpc = (GetQpcFrequency() * PublishInterval.count()) / 1000;
+}
+
+SharedMemorySink::~SharedMemorySink()
+{
+    // Viewers may keep the segment alive after we're gone
+    m_header->Closed.store(1, std::memory_order_release);
+}
+
+void SharedMemorySink::Write(FrameRecord const& record)
+{
+    auto slotIndex = record.SessionIndex % LiveStatsSlotCount;
+    auto& state = m_states[slotIndex];
+    std::scoped_lock lock(state.Lock);
+    if (!state.Started || state.RunId != record.RunId)
+    {
+        state.Started = true;
+        state.RunId = record.RunId;
+        state.FramesClosed = 0;
+        state.FramesDropped = 0;
+        state.WindowStartQpc = record.CloseQpc;
+        state.WindowFrames = 0;
+        state.WindowHoldTotal = 0;
+        state.WindowHoldMax = 0;
+    }
+
+    state.FramesClosed++;
+    if (record.Overwritten || record.QueueDropped)
+    {
+        state.FramesDropped++;
+    }
+    state.WindowFrames++;
+    state.WindowHoldTotal += record.HoldTimeInMicroseconds;
+    state.WindowHoldMax = std::max(state.WindowHoldMax, record.HoldTimeInMicroseconds);
+
+    auto windowQpc = record.CloseQpc - state.WindowStartQpc;
+    if (windowQpc < m_publishIntervalQpc)
+    {
+        return;
+    }
+
+    LiveSessionStats stats = {};
+    stats.RunId = record.RunId;
+    stats.SessionIndex = record.SessionIndex;
+    stats.UpdateQpc = record.CloseQpc;
+    stats.FramesClosed = state.FramesClosed;
+    stats.FramesDropped = state.FramesDropped;
+    stats.FramesPerSecond = static_cast<double>(state.WindowFrames) / QpcToSeconds(windowQpc);
+    stats.MeanHoldTimeInMicroseconds = static_cast<double>(state.WindowHoldTotal) / static_cast<double>(state.WindowFrames);
+    stats.MaxHoldTimeInMicroseconds = state.WindowHoldMax;
+    stats.QueueDepth = record.QueueDepth;
+    Publish(slotIndex, stats);
+
+    state.WindowStartQpc = record.CloseQpc;
+    state.WindowFrames = 0;
+    state.WindowHoldTotal = 0;
+    state.WindowHoldMax = 0;
+}
+
+void SharedMemorySink::Publish(uint32_t slotIndex, LiveSessionStats const& stats)
+{
+    auto& slot = m_slots[slotIndex];
+    auto sequence = slot.Sequence.load(std::memory_order_relaxed);
+    slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    // Keeps the stats from being written before readers can see the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Stats = stats;
+    slot.Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+std::unique_ptr<LiveStatsReader> LiveStatsReader::Open(std::wstring const& name)
+{
+    wil::unique_handle mapping(OpenFileMappingW(FILE_MAP_READ, FALSE, name.c_str()));
+    if (!mapping.is_valid())
+    {
+        return nullptr;
+    }
+    wil::unique_mapview_ptr<void> view(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, LiveStatsSize));
+    if (view == nullptr)
+    {
+        return nullptr;
+    }
+    // Written by a different build of the tool, or something else entirely
+    auto header = reinterpret_cast<LiveStatsHeader const*>(view.get());
+    if (header->Magic != LiveStatsMagic || header->Version != LiveStatsVersion || header->SlotSize != sizeof(LiveStatsSlot) || header->SlotCount != LiveStatsSlotCount)
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<LiveStatsReader>(new LiveStatsReader(std::move(mapping), std::move(view)));
+}
+
+LiveStatsReader::LiveStatsReader(wil::unique_handle mapping, wil::unique_mapview_ptr<void> view) : m_mapping(std::move(mapping)), m_view(std::move(view))
+{
+    m_header = reinterpret_cast<LiveStatsHeader const*>(m_view.get());
+    m_slots = reinterpret_cast<LiveStatsSlot const*>(reinterpret_cast<uint8_t const*>(m_view.get()) + sizeof(LiveStatsHeader));
+}
+
+bool LiveStatsReader::Closed() const
+{
+    return m_header->Closed.load(std::memory_order_acquire) != 0;
+}
+
+std::vector<LiveSessionStats> LiveStatsReader::Read() const
+{
+    std::vector<LiveSessionStats> result;
+    for (uint32_t slotIndex = 0; slotIndex < LiveStatsSlotCount; slotIndex++)
+    {
+        auto const& slot = m_slots[slotIndex];
+        // A writer only holds a slot for a copy, so this rarely spins
+        for (int attempt = 0; attempt < 1000; attempt++)
+        {
+            auto before = slot.Sequence.load(std::memory_order_acquire);
+            if (before == 0)
+            {
+                break;
+            }
+            if ((before & 1) != 0)
+            {
+                YieldProcessor();
+                continue;
+            }
+            auto stats = slot.Stats;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.Sequence.load(std::memory_order_relaxed) == before)
+            {
+                result.push_back(stats);
+                break;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+#include "ResultsSink.h"
+
+// Layout of the named shared memory published with -liveStats, a header
+// followed by one slot per concurrent session. Each slot is a seqlock: the
+// writer makes Sequence odd, updates Stats and makes it even again, readers
+// copy Stats and retry if Sequence was odd or changed in the meantime.
+constexpr uint32_t LiveStatsMagic = 0x53545243; // "CRTS"
+constexpr uint32_t LiveStatsVersion = 1;
+constexpr uint32_t LiveStatsSlotCount = 32;
+
+struct LiveSessionStats
+{
+    uint32_t RunId;
+    uint32_t SessionIndex;
+    // When the stats were last published, on the system wide QPC clock
+    int64_t UpdateQpc;
+    // Since the session's first frame
+    uint64_t FramesClosed;
+    // Overwritten before they were released, or dropped by a full worker queue
+    uint64_t FramesDropped;
+    // Over the last publish window
+    double FramesPerSecond;
+    double MeanHoldTimeInMicroseconds;
+    int64_t MaxHoldTimeInMicroseconds;
+    // Of the last frame, -1 without workers
+    int32_t QueueDepth;
+};
+
+struct alignas(64) LiveStatsSlot
+{
+    // Zero until the slot is first written
+    std::atomic<uint32_t> Sequence;
+    LiveSessionStats Stats;
+};
+
+struct alignas(64) LiveStatsHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t SlotSize;
+    uint32_t SlotCount;
+    int64_t QpcFrequency;
+    uint32_t ProcessId;
+    // Set once the publishing process is done with the segment
+    std::atomic<uint32_t> Closed;
+};
+
+// Publishes rolling per-session stats to named shared memory, so a viewer
+// can poll a running benchmark without parsing its output. Sessions map to
+// slots by SessionIndex, a later run takes over its slot. Stats are only
+// copied into the segment every PublishInterval, most records just update
+// a few counters.
+class SharedMemorySink : public ResultsSink
+{
+public:
+    static constexpr std::chrono::milliseconds PublishInterval{ 250 };
+
+    // Throws if the segment can't be created or another process already
+    // publishes under the name
+    explicit SharedMemorySink(std::wstring const& name);
+    ~SharedMemorySink() override;
+
+    void Write(FrameRecord const& record) override;
+
+private:
+    // Process local, the segment only holds what has been published
+    struct SlotState
+    {
+        // Workers close frames concurrently, and a seqlock needs a single writer
+        std::mutex Lock;
+        bool Started = false;
+        uint32_t RunId = 0;
+        uint64_t FramesClosed = 0;
+        uint64_t FramesDropped = 0;
+        int64_t WindowStartQpc = 0;
+        uint64_t WindowFrames = 0;
+        int64_t WindowHoldTotal = 0;
+        int64_t WindowHoldMax = 0;
+    };
+
+    void Publish(uint32_t slotIndex, LiveSessionStats const& stats);
+
+private:
+    wil::unique_handle m_mapping;
+    wil::unique_mapview_ptr<void> m_view;
+    LiveStatsHeader* m_header = nullptr;
+    LiveStatsSlot* m_slots = nullptr;
+    int64_t m_publishIntervalQpc = 0;
+    std::array<SlotState, LiveStatsSlotCount> m_states;
+};
+
+// Opens a segment published by another process for reading
+class LiveStatsReader
+{
+public:
+    // nullptr if nothing is published under the name
+    static std::unique_ptr<LiveStatsReader> Open(std::wstring const& name);
+
+    // The publisher has closed the segment
+    bool Closed() const;
+    // Consistent copies of every slot that has been written
+    std::vector<LiveSessionStats> Read() const;
+
+private:
+    LiveStatsReader(wil::unique_handle mapping, wil::unique_mapview_ptr<void> view);
+
+private:
+    wil::unique_handle m_mapping;
+    wil::unique_mapview_ptr<void> m_view;
+    LiveStatsHeader const* m_header = nullptr;
+    LiveStatsSlot const* m_slots = nullptr;
+};
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+// DirectXPixelFormat shares its values with DXGI_FORMAT
+inline DXGI_FORMAT GetDxgiFormat(winrt::Windows::Graphics::DirectX::DirectXPixelFormat format)
+{
+    return static_cast<DXGI_FORMAT>(format);
+}
+
+inline uint32_t GetBytesPerPixel(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+inline uint32_t GetBytesPerPixel(winrt::Windows::Graphics::DirectX::DirectXPixelFormat format)
+{
+    return GetBytesPerPixel(GetDxgiFormat(format));
+}
+
+inline std::wstring GetPixelFormatName(winrt::Windows::Graphics::DirectX::DirectXPixelFormat format)
+{
+    switch (format)
+    {
+    case winrt::Windows::Graphics::DirectX::DirectXPixelFormat::B8G8R8A8UIntNormalized:
+        return L"bgra8";
+    case winrt::Windows::Graphics::DirectX::DirectXPixelFormat::R16G16B16A16Float:
+        return L"fp16";
+    default:
+        return std::to_wstring(static_cast<int32_t>(format));
+    }
+}
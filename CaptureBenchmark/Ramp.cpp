@@ -0,0 +1,116 @@
+﻿#include "pch.h"
+#include "Ramp.h"
+
+static uint32_t GetNextInterval(uint32_t interval, RampOptions const& options)
+{
+    auto next = static_cast<uint32_t>(std::floor(static_cast<double>(interval) * options.StepFactor));
+    next = std::min(next, interval - 1);
+    return std::max(next, options.MinimumIntervalInMs);
+}
+
+static void PrintStepHeader()
+{
+    wprintf(L"    %10s %10s %10s %10s %12s\n", L"Interval", L"Expected", L"FPS", L"Tracking", L"Lat p99 ms");
+}
+
+static void PrintStep(RampStep const& step)
+{
+    auto tracking = step.ExpectedFramesPerSecond > 0.0 ? (100.0 * step.Summary.FramesPerSecond / step.ExpectedFramesPerSecond) : 0.0;
+    wprintf(L"    %8u ms %10.2f %10.2f %9.1f%% %12.3f\n",
+        step.IntervalInMs,
+        step.ExpectedFramesPerSecond,
+        step.Summary.FramesPerSecond,
+        tracking,
+        step.Summary.CaptureLatency.P99 / 1000.0);
+}
+
+RampResult RunRamp(CaptureRunner& runner, RampOptions const& options)
+{
+    RampResult result = {};
+    result.Label = runner.DisplayName();
+    result.Limit = RampLimit::None;
+
+    PrintStepHeader();
+    std::optional<double> lowestLatency;
+    auto interval = std::max(options.StartIntervalInMs, options.MinimumIntervalInMs);
+    while (true)
+    {
+        runner.SetReleaseInterval(std::chrono::milliseconds(interval));
+        std::this_thread::sleep_for(std::chrono::seconds(options.SettleInSeconds));
+        runner.ResetStats();
+        std::this_thread::sleep_for(std::chrono::seconds(options.StepInSeconds));
+
+        RampStep step = {};
+        step.IntervalInMs = interval;
+        step.Summary = runner.Summarize();
+        auto releaseRate = 1000.0 / static_cast<double>(interval);
+        auto refreshRate = step.Summary.RefreshRate;
+        step.ExpectedFramesPerSecond = refreshRate > 0.0 ? std::min(releaseRate, refreshRate) : releaseRate;
+        result.Steps.push_back(step);
+        PrintStep(step);
+
+        auto latency = static_cast<double>(step.Summary.CaptureLatency.P99);
+        if (step.Summary.FramesPerSecond < options.TrackingFraction * step.ExpectedFramesPerSecond)
+        {
+            result.Limit = RampLimit::Tracking;
+            break;
+        }
+        if (lowestLatency.has_value() &&
+            latency > options.LatencySpikeFactor * lowestLatency.value() &&
+            latency - lowestLatency.value() >= options.MinimumLatencySpikeInMicroseconds)
+        {
+            result.Limit = RampLimit::Latency;
+            break;
+        }
+        lowestLatency = std::min(latency, lowestLatency.value_or(latency));
+        result.SustainableStep = result.Steps.size() - 1;
+
+        if (refreshRate > 0.0 && releaseRate >= refreshRate)
+        {
+            result.Limit = RampLimit::RefreshRate;
+            break;
+        }
+        if (interval <= options.MinimumIntervalInMs)
+        {
+            break;
+        }
+        interval = GetNextInterval(interval, options);
+    }
+    return result;
+}
+
+static wchar_t const* GetRampLimitDescription(RampLimit limit)
+{
+    switch (limit)
+    {
+    case RampLimit::RefreshRate:
+        return L"reached the refresh rate";
+    case RampLimit::Tracking:
+        return L"fps fell behind the release rate";
+    case RampLimit::Latency:
+        return L"p99 latency spiked";
+    default:
+        return L"reached the minimum interval";
+    }
+}
+
+void PrintRampReport(std::vector<RampResult> const& results)
+{
+    wprintf(L"\n");
+    wprintf(L"%-32s %10s %10s %12s  %s\n", L"Target", L"Interval", L"FPS", L"Lat p99 ms", L"Stopped because");
+    for (auto&& result : results)
+    {
+        if (!result.SustainableStep.has_value())
+        {
+            wprintf(L"%-32s %10s %10s %12s  %s at the first step\n", result.Label.c_str(), L"-", L"-", L"-", GetRampLimitDescription(result.Limit));
+            continue;
+        }
+        auto const& step = result.Steps[result.SustainableStep.value()];
+        wprintf(L"%-32s %7u ms %10.2f %12.3f  %s\n",
+            result.Label.c_str(),
+            step.IntervalInMs,
+            step.Summary.FramesPerSecond,
+            step.Summary.CaptureLatency.P99 / 1000.0,
+            GetRampLimitDescription(result.Limit));
+    }
+}
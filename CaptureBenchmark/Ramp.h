@@ -0,0 +1,56 @@
+﻿#pragma once
+#include "CaptureRunner.h"
+
+struct RampOptions
+{
+    uint32_t StartIntervalInMs = 1000;
+    uint32_t MinimumIntervalInMs = 1;
+    // Each interval is the previous one times this, and at least 1ms shorter
+    double StepFactor = 0.75;
+    uint32_t StepInSeconds = 3;
+    // After each change, so frames released at the old interval aren't counted
+    uint32_t SettleInSeconds = 1;
+    // Delivered fps has to stay above this fraction of the expected rate
+    double TrackingFraction = 0.9;
+    // p99 capture latency above this multiple of the lowest step's is a
+    // spike, if it also grew by at least the minimum
+    double LatencySpikeFactor = 2.0;
+    uint32_t MinimumLatencySpikeInMicroseconds = 2000;
+};
+
+struct RampStep
+{
+    uint32_t IntervalInMs;
+    // Releases per second, capped at the refresh rate when it's known
+    double ExpectedFramesPerSecond;
+    CaptureSummary Summary;
+};
+
+enum class RampLimit
+{
+    // Kept up all the way to the minimum interval
+    None,
+    // Kept up with the refresh rate, going faster can't deliver more
+    RefreshRate,
+    // Delivered fps fell behind the release rate
+    Tracking,
+    // p99 latency spiked
+    Latency,
+};
+
+struct RampResult
+{
+    std::wstring Label;
+    std::vector<RampStep> Steps;
+    // The last step before the knee, empty if the first one already failed
+    std::optional<size_t> SustainableStep;
+    RampLimit Limit;
+};
+
+// Shortens the release interval of a running session step by step until
+// delivered fps stops tracking the release rate or latency spikes. Frames
+// are only delivered when the content changes, so the content has to keep
+// up with the fastest rate being tested.
+RampResult RunRamp(CaptureRunner& runner, RampOptions const& options);
+// Prints the sustainable release rate per target
+void PrintRampReport(std::vector<RampResult> const& results);
@@ -0,0 +1,185 @@
+﻿#include "pch.h"
+#include "ReleaseScheduler.h"
+#include "DisplayInfo.h"
+#include "Timing.h"
+
+namespace winrt
+{
+    using namespace Windows::Foundation;
+    using namespace Windows::System;
+}
+
+// At least one tick, the threaded schedulers divide by it to skip missed
+// deadlines
+static int64_t IntervalToQpc(std::chrono::milliseconds interval)
+{
+    return std::max<int64_t>(HundredNanosecondsToQpc(std::chrono::duration_cast<winrt::TimeSpan>(interval).count()), 1);
+}
+
+DispatcherReleaseScheduler::DispatcherReleaseScheduler(winrt::DispatcherQueue const& queue, std::chrono::milliseconds interval)
+{
+    m_intervalQpc = IntervalToQpc(interval);
+    m_timer = queue.CreateTimer();
+    m_timer.Interval(interval);
+    m_timer.IsRepeating(true);
+}
+
+void DispatcherReleaseScheduler::Start(ReleaseCallback const& callback)
+{
+    m_lastTickQpc = GetQpcNow();
+    m_timer.Tick([this, callback](auto&&, auto&&)
+        {
+            // The timer reschedules relative to the last tick, so measure
+            // the error against that rather than an ideal cadence
+            auto nowQpc = GetQpcNow();
+            auto scheduledQpc = m_lastTickQpc + m_intervalQpc;
+            m_lastTickQpc = nowQpc;
+            callback(scheduledQpc, nowQpc);
+        });
+    m_timer.Start();
+}
+
+void DispatcherReleaseScheduler::Stop()
+{
+    m_timer.Stop();
+}
+
+void DispatcherReleaseScheduler::SetInterval(std::chrono::milliseconds interval)
+{
+    // Tick runs on this thread too, so nothing else touches these
+    m_intervalQpc = IntervalToQpc(interval);
+    m_timer.Interval(interval);
+}
+
+ThreadedReleaseScheduler::ThreadedReleaseScheduler(std::chrono::milliseconds interval)
+{
+    m_intervalQpc.store(IntervalToQpc(interval));
+}
+
+ThreadedReleaseScheduler::~ThreadedReleaseScheduler()
+{
+    Stop();
+}
+
+void ThreadedReleaseScheduler::Start(ReleaseCallback const& callback)
+{
+    m_thread = std::thread([this, callback]()
+        {
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+            // A failed timer or release stops releasing, not the process.
+            // Frames are still closed when they're overwritten or on Stop.
+            try
+            {
+                Run(callback);
+            }
+            catch (...)
+            {
+                m_error.store(winrt::to_hresult());
+            }
+        });
+}
+
+void ThreadedReleaseScheduler::Stop()
+{
+    m_stopping.store(true);
+    m_stopEvent.SetEvent();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void ThreadedReleaseScheduler::SetInterval(std::chrono::milliseconds interval)
+{
+    m_intervalQpc.store(IntervalToQpc(interval));
+}
+
+HighResolutionReleaseScheduler::HighResolutionReleaseScheduler(std::chrono::milliseconds interval) : ThreadedReleaseScheduler(interval)
+{
+    m_timer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+    winrt::check_bool(m_timer.is_valid());
+}
+
+void HighResolutionReleaseScheduler::Run(ReleaseCallback const& callback)
+{
+    HANDLE handles[] = { m_stopEvent.get(), m_timer.get() };
+    auto deadlineQpc = GetQpcNow() + m_intervalQpc.load();
+    while (!m_stopping.load())
+    {
+        // Absolute deadlines keep the cadence from drifting
+        auto remainingQpc = std::max<int64_t>(deadlineQpc - GetQpcNow(), 0);
+        LARGE_INTEGER dueTime = {};
+        dueTime.QuadPart = -QpcToHundredNanoseconds(remainingQpc);
+        winrt::check_bool(SetWaitableTimerEx(m_timer.get(), &dueTime, 0, nullptr, nullptr, nullptr, 0));
+
+        auto result = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE);
+        if (result != WAIT_OBJECT_0 + 1)
+        {
+            break;
+        }
+        callback(deadlineQpc, GetQpcNow());
+
+        // Skip deadlines we already missed instead of releasing in a burst
+        auto intervalQpc = m_intervalQpc.load();
+        deadlineQpc += intervalQpc;
+        auto nowQpc = GetQpcNow();
+        if (deadlineQpc < nowQpc)
+        {
+            auto missed = ((nowQpc - deadlineQpc) / intervalQpc) + 1;
+            deadlineQpc += missed * intervalQpc;
+        }
+    }
+}
+
+VBlankReleaseScheduler::VBlankReleaseScheduler(HMONITOR monitor, std::chrono::milliseconds interval) : ThreadedReleaseScheduler(interval)
+{
+    m_output = FindOutputForMonitor(monitor);
+    if (m_output == nullptr)
+    {
+        throw winrt::hresult_error(DXGI_ERROR_NOT_FOUND, L"Could not find a DXGI output for the captured monitor.");
+    }
+}
+
+void VBlankReleaseScheduler::Run(ReleaseCallback const& callback)
+{
+    auto deadlineQpc = GetQpcNow() + m_intervalQpc.load();
+    while (!m_stopping.load())
+    {
+        // Blocks for at most one refresh, so stopping stays responsive
+        if (FAILED(m_output->WaitForVBlank()))
+        {
+            break;
+        }
+        auto nowQpc = GetQpcNow();
+        if (nowQpc >= deadlineQpc)
+        {
+            callback(deadlineQpc, nowQpc);
+            auto intervalQpc = m_intervalQpc.load();
+            deadlineQpc += intervalQpc;
+            if (deadlineQpc < nowQpc)
+            {
+                auto missed = ((nowQpc - deadlineQpc) / intervalQpc) + 1;
+                deadlineQpc += missed * intervalQpc;
+            }
+        }
+    }
+}
+
+std::unique_ptr<ReleaseScheduler> CreateReleaseScheduler(
+    ReleaseSchedulerKind kind,
+    std::chrono::milliseconds interval,
+    winrt::DispatcherQueue const& queue,
+    HMONITOR monitor)
+{
+    switch (kind)
+    {
+    case ReleaseSchedulerKind::Dispatcher:
+        return std::make_unique<DispatcherReleaseScheduler>(queue, interval);
+    case ReleaseSchedulerKind::HighResolution:
+        return std::make_unique<HighResolutionReleaseScheduler>(interval);
+    case ReleaseSchedulerKind::VBlank:
+        return std::make_unique<VBlankReleaseScheduler>(monitor, interval);
+    default:
+        throw winrt::hresult_invalid_argument();
+    }
+}
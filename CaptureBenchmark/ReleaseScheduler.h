@@ -0,0 +1,103 @@
+﻿#pragma once
+
+enum class ReleaseSchedulerKind
+{
+    // DispatcherQueueTimer on the capture thread, ~15.6ms granularity
+    Dispatcher,
+    // Dedicated thread waiting on a CREATE_WAITABLE_TIMER_HIGH_RESOLUTION timer
+    HighResolution,
+    // Dedicated thread releasing on the first vblank after each deadline
+    VBlank,
+};
+
+// Decides when the held frame is released. The callback receives the QPC
+// time the release was scheduled for and when it actually ran, so the
+// scheduling error can be tracked alongside the capture stats.
+class ReleaseScheduler
+{
+public:
+    typedef std::function<void(int64_t scheduledQpc, int64_t actualQpc)> ReleaseCallback;
+
+    virtual ~ReleaseScheduler() = default;
+    virtual void Start(ReleaseCallback const& callback) = 0;
+    virtual void Stop() = 0;
+    // Called from the thread that called Start. Takes effect from the
+    // next release on.
+    virtual void SetInterval(std::chrono::milliseconds interval) = 0;
+    // Why releases stopped early, S_OK if they didn't
+    virtual HRESULT Error() const { return S_OK; }
+};
+
+class DispatcherReleaseScheduler : public ReleaseScheduler
+{
+public:
+    DispatcherReleaseScheduler(winrt::Windows::System::DispatcherQueue const& queue, std::chrono::milliseconds interval);
+
+    void Start(ReleaseCallback const& callback) override;
+    void Stop() override;
+    void SetInterval(std::chrono::milliseconds interval) override;
+
+private:
+    winrt::Windows::System::DispatcherQueueTimer m_timer{ nullptr };
+    int64_t m_intervalQpc = 0;
+    int64_t m_lastTickQpc = 0;
+};
+
+// Shared by the schedulers that own a thread
+class ThreadedReleaseScheduler : public ReleaseScheduler
+{
+public:
+    ~ThreadedReleaseScheduler() override;
+
+    void Start(ReleaseCallback const& callback) override;
+    void Stop() override;
+    void SetInterval(std::chrono::milliseconds interval) override;
+    HRESULT Error() const override { return m_error.load(); }
+
+protected:
+    ThreadedReleaseScheduler(std::chrono::milliseconds interval);
+    virtual void Run(ReleaseCallback const& callback) = 0;
+
+protected:
+    // Read by the scheduler thread once per release
+    std::atomic<int64_t> m_intervalQpc{ 0 };
+    wil::unique_event m_stopEvent{ wil::EventOptions::ManualReset };
+    std::atomic<bool> m_stopping{ false };
+
+private:
+    std::thread m_thread;
+    std::atomic<HRESULT> m_error{ S_OK };
+};
+
+class HighResolutionReleaseScheduler : public ThreadedReleaseScheduler
+{
+public:
+    HighResolutionReleaseScheduler(std::chrono::milliseconds interval);
+    // The thread has to be gone before our members are
+    ~HighResolutionReleaseScheduler() override { Stop(); }
+
+protected:
+    void Run(ReleaseCallback const& callback) override;
+
+private:
+    wil::unique_handle m_timer;
+};
+
+class VBlankReleaseScheduler : public ThreadedReleaseScheduler
+{
+public:
+    VBlankReleaseScheduler(HMONITOR monitor, std::chrono::milliseconds interval);
+    ~VBlankReleaseScheduler() override { Stop(); }
+
+protected:
+    void Run(ReleaseCallback const& callback) override;
+
+private:
+    winrt::com_ptr<IDXGIOutput> m_output;
+};
+
+std::unique_ptr<ReleaseScheduler> CreateReleaseScheduler(
+    ReleaseSchedulerKind kind,
+    std::chrono::milliseconds interval,
+    winrt::Windows::System::DispatcherQueue const& queue,
+    HMONITOR monitor);
@@ -0,0 +1,273 @@
+﻿#include "pch.h"
+#include "ResultsSink.h"
+#include <TraceLoggingProvider.h>
+
+// {5F1B8C7E-3A2D-4C61-9B0E-7D4A2E6F9C13}
+TRACELOGGING_DEFINE_PROVIDER(
+    g_captureRateTestProvider,
+    "CaptureRateTest",
+    (0x5f1b8c7e, 0x3a2d, 0x4c61, 0x9b, 0x0e, 0x7d, 0x4a, 0x2e, 0x6f, 0x9c, 0x13));
+
+static void WriteAll(HANDLE file, std::string const& text)
+{
+    DWORD written = 0;
+    winrt::check_bool(WriteFile(file, text.data(), static_cast<DWORD>(text.size()), &written, nullptr));
+    if (written != text.size())
+    {
+        throw winrt::hresult_error(HRESULT_FROM_WIN32(ERROR_WRITE_FAULT), L"Short write to the output file.");
+    }
+}
+
+BufferedFileSink::BufferedFileSink(std::wstring const& path, RecordFormat format) : m_format(format)
+{
+    m_file.reset(CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    winrt::check_bool(m_file.is_valid());
+
+    if (m_format == RecordFormat::Csv)
+    {
+        std::string header = "run,session,frame,system_relative_time,arrival_qpc,close_qpc,hold_us,latency_us,content_width,content_height,surface,surface_reused,overwritten,dirty_rects,dirty_fraction,content_frame,present_latency_us,queue_depth,queue_dropped,vblanks,vblank_error\n";
+        WriteAll(m_file.get(), header);
+    }
+
+    m_pending.reserve(WakeThreshold);
+    m_thread = std::thread([this]() { WriterThread(); });
+}
+
+BufferedFileSink::~BufferedFileSink()
+{
+    {
+        std::scoped_lock lock(m_lock);
+        m_stopping = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+    std::scoped_lock lock(m_lock);
+    ReportError();
+}
+
+void BufferedFileSink::Write(FrameRecord const& record)
+{
+    bool wake = false;
+    {
+        std::scoped_lock lock(m_lock);
+        m_pending.push_back(record);
+        wake = m_pending.size() >= WakeThreshold;
+    }
+    if (wake)
+    {
+        m_condition.notify_one();
+    }
+}
+
+void BufferedFileSink::Flush()
+{
+    std::unique_lock lock(m_lock);
+    auto target = ++m_flushRequested;
+    m_condition.notify_one();
+    m_flushCondition.wait(lock, [&]() { return m_flushCompleted >= target; });
+    ReportError();
+}
+
+void BufferedFileSink::ReportError()
+{
+    if (m_error != S_OK && !m_errorReported)
+    {
+        m_errorReported = true;
+        wprintf(L"Writing frame records failed, the output is incomplete: %s\n", winrt::hresult_error(m_error).message().c_str());
+    }
+}
+
+void BufferedFileSink::WriterThread()
+{
+    std::vector<FrameRecord> records;
+    records.reserve(WakeThreshold);
+
+    std::unique_lock lock(m_lock);
+    while (true)
+    {
+        // Wake up periodically so a slow trickle of frames still gets written
+        m_condition.wait_for(lock, std::chrono::milliseconds(250), [&]()
+            {
+                return m_stopping || m_pending.size() >= WakeThreshold || m_flushRequested > m_flushCompleted;
+            });
+        records.swap(m_pending);
+        auto flushTarget = m_flushRequested;
+        auto stopping = m_stopping;
+        auto failed = m_error != S_OK;
+        lock.unlock();
+
+        // A full disk or a dropped share shouldn't take the run down with it
+        auto error = S_OK;
+        if (!failed)
+        {
+            try
+            {
+                WriteRecords(records);
+            }
+            catch (...)
+            {
+                error = winrt::to_hresult();
+            }
+        }
+        records.clear();
+
+        lock.lock();
+        if (error != S_OK)
+        {
+            m_error = error;
+        }
+        m_flushCompleted = flushTarget;
+        m_flushCondition.notify_all();
+        if (stopping && m_pending.empty())
+        {
+            break;
+        }
+    }
+}
+
+void BufferedFileSink::WriteRecords(std::vector<FrameRecord> const& records)
+{
+    if (records.empty())
+    {
+        return;
+    }
+
+    std::string text;
+    text.reserve(records.size() * 256);
+    std::array<char, 1024> line = {};
+    for (auto const& record : records)
+    {
+        int length = 0;
+        if (m_format == RecordFormat::Csv)
+        {
+            length = snprintf(line.data(), line.size(),
+                "%u,%u,%llu,%lld,%lld,%lld,%lld,%lld,%d,%d,0x%llx,%d,%d,%d,%.4f,%lld,%lld,%d,%d,%d,%.4f\n",
+                record.RunId,
+                record.SessionIndex,
+                record.FrameIndex,
+                record.SystemRelativeTime,
+                record.ArrivalQpc,
+                record.CloseQpc,
+                record.HoldTimeInMicroseconds,
+                record.CaptureLatencyInMicroseconds,
+                record.ContentWidth,
+                record.ContentHeight,
+                record.Surface,
+                record.SurfaceReused ? 1 : 0,
+                record.Overwritten ? 1 : 0,
+                record.DirtyRectCount,
+                record.DirtyAreaFraction,
+                record.ContentFrameIndex,
+                record.PresentLatencyInMicroseconds,
+                record.QueueDepth,
+                record.QueueDropped ? 1 : 0,
+                record.Vblanks,
+                record.VblankError);
+        }
+        else
+        {
+            length = snprintf(line.data(), line.size(),
+                "{\"run\":%u,\"session\":%u,\"frame\":%llu,\"system_relative_time\":%lld,\"arrival_qpc\":%lld,\"close_qpc\":%lld,"
+                "\"hold_us\":%lld,\"latency_us\":%lld,\"content_width\":%d,\"content_height\":%d,"
+                "\"surface\":\"0x%llx\",\"surface_reused\":%s,\"overwritten\":%s,\"dirty_rects\":%d,\"dirty_fraction\":%.4f,"
+                "\"content_frame\":%lld,\"present_latency_us\":%lld,\"queue_depth\":%d,\"queue_dropped\":%s,\"vblanks\":%d,\"vblank_error\":%.4f}\n",
+                record.RunId,
+                record.SessionIndex,
+                record.FrameIndex,
+                record.SystemRelativeTime,
+                record.ArrivalQpc,
+                record.CloseQpc,
+                record.HoldTimeInMicroseconds,
+                record.CaptureLatencyInMicroseconds,
+                record.ContentWidth,
+                record.ContentHeight,
+                record.Surface,
+                record.SurfaceReused ? "true" : "false",
+                record.Overwritten ? "true" : "false",
+                record.DirtyRectCount,
+                record.DirtyAreaFraction,
+                record.ContentFrameIndex,
+                record.PresentLatencyInMicroseconds,
+                record.QueueDepth,
+                record.QueueDropped ? "true" : "false",
+                record.Vblanks,
+                record.VblankError);
+        }
+        if (length > 0)
+        {
+            text.append(line.data(), std::min<size_t>(length, line.size() - 1));
+        }
+    }
+    WriteAll(m_file.get(), text);
+}
+
+TraceLoggingSink::TraceLoggingSink()
+{
+    winrt::check_hresult(TraceLoggingRegister(g_captureRateTestProvider));
+}
+
+TraceLoggingSink::~TraceLoggingSink()
+{
+    TraceLoggingUnregister(g_captureRateTestProvider);
+}
+
+void TraceLoggingSink::Write(FrameRecord const& record)
+{
+    TraceLoggingWrite(
+        g_captureRateTestProvider,
+        "FrameClosed",
+        TraceLoggingUInt32(record.RunId, "RunId"),
+        TraceLoggingUInt32(record.SessionIndex, "SessionIndex"),
+        TraceLoggingUInt64(record.FrameIndex, "FrameIndex"),
+        TraceLoggingInt64(record.SystemRelativeTime, "SystemRelativeTime"),
+        TraceLoggingInt64(record.ArrivalQpc, "ArrivalQpc"),
+        TraceLoggingInt64(record.CloseQpc, "CloseQpc"),
+        TraceLoggingInt64(record.HoldTimeInMicroseconds, "HoldTimeInMicroseconds"),
+        TraceLoggingInt64(record.CaptureLatencyInMicroseconds, "CaptureLatencyInMicroseconds"),
+        TraceLoggingInt32(record.ContentWidth, "ContentWidth"),
+        TraceLoggingInt32(record.ContentHeight, "ContentHeight"),
+        TraceLoggingHexUInt64(record.Surface, "Surface"),
+        TraceLoggingBool(record.SurfaceReused, "SurfaceReused"),
+        TraceLoggingBool(record.Overwritten, "Overwritten"),
+        TraceLoggingInt32(record.DirtyRectCount, "DirtyRectCount"),
+        TraceLoggingFloat64(record.DirtyAreaFraction, "DirtyAreaFraction"),
+        TraceLoggingInt64(record.ContentFrameIndex, "ContentFrameIndex"),
+        TraceLoggingInt64(record.PresentLatencyInMicroseconds, "PresentLatencyInMicroseconds"),
+        TraceLoggingInt32(record.QueueDepth, "QueueDepth"),
+        TraceLoggingBool(record.QueueDropped, "QueueDropped"),
+        TraceLoggingInt32(record.Vblanks, "Vblanks"),
+        TraceLoggingFloat64(record.VblankError, "VblankError"));
+}
+
+void MemorySink::Write(FrameRecord const& record)
+{
+    std::scoped_lock lock(m_lock);
+    m_records.push_back(record);
+}
+
+std::vector<FrameRecord> MemorySink::Records()
+{
+    std::scoped_lock lock(m_lock);
+    return m_records;
+}
+
+std::shared_ptr<ResultsSink> CreateFileSinkFromPath(std::wstring const& path)
+{
+    auto extensionStart = path.find_last_of(L'.');
+    if (extensionStart == std::wstring::npos)
+    {
+        return nullptr;
+    }
+    auto extension = path.substr(extensionStart);
+    std::transform(extension.begin(), extension.end(), extension.begin(), towlower);
+
+    if (extension == L".csv")
+    {
+        return std::make_shared<BufferedFileSink>(path, RecordFormat::Csv);
+    }
+    else if (extension == L".jsonl" || extension == L".json")
+    {
+        return std::make_shared<BufferedFileSink>(path, RecordFormat::JsonLines);
+    }
+    return nullptr;
+}
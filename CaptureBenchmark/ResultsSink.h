@@ -0,0 +1,115 @@
+﻿#pragma once
+
+// One record per frame, written once the frame has been closed
+struct FrameRecord
+{
+    uint32_t RunId;
+    uint32_t SessionIndex;
+    uint64_t FrameIndex;
+    // 100ns units
+    int64_t SystemRelativeTime;
+    int64_t ArrivalQpc;
+    int64_t CloseQpc;
+    int64_t HoldTimeInMicroseconds;
+    int64_t CaptureLatencyInMicroseconds;
+    int32_t ContentWidth;
+    int32_t ContentHeight;
+    uint64_t Surface;
+    bool SurfaceReused;
+    bool Overwritten;
+    // Dropped because the worker queue was full, closed without being held
+    bool QueueDropped;
+    // -1 when dirty regions aren't being reported
+    int32_t DirtyRectCount;
+    // Fraction of the content covered by dirty rects
+    double DirtyAreaFraction;
+    // Generated content only, -1 otherwise or when the counter couldn't be
+    // read. From the generator's Present to FrameArrived.
+    int64_t ContentFrameIndex;
+    int64_t PresentLatencyInMicroseconds;
+    // Frames waiting for a worker when this one was queued, -1 without workers
+    int32_t QueueDepth;
+    // SystemRelativeTime gap to the previous frame in refresh periods, and
+    // how far it was from a whole number of them as a fraction of a period.
+    // -1 for the first frame or when the refresh rate is unknown.
+    int32_t Vblanks;
+    double VblankError;
+};
+
+// Sinks are written to from the capture thread, implementations must keep
+// Write cheap and defer any I/O.
+class ResultsSink
+{
+public:
+    virtual ~ResultsSink() = default;
+    virtual void Write(FrameRecord const& record) = 0;
+    virtual void Flush() {}
+};
+
+enum class RecordFormat
+{
+    Csv,
+    JsonLines,
+};
+
+// Batches records in memory and writes them to a file on a background thread
+class BufferedFileSink : public ResultsSink
+{
+public:
+    BufferedFileSink(std::wstring const& path, RecordFormat format);
+    ~BufferedFileSink() override;
+
+    void Write(FrameRecord const& record) override;
+    // Prints the first write error, if there was one, rather than throwing
+    // and losing the run's results
+    void Flush() override;
+
+private:
+    void WriterThread();
+    void WriteRecords(std::vector<FrameRecord> const& records);
+    // Expects m_lock to be held
+    void ReportError();
+
+private:
+    static constexpr size_t WakeThreshold = 1024;
+
+    RecordFormat m_format;
+    wil::unique_hfile m_file;
+    std::mutex m_lock;
+    std::condition_variable m_condition;
+    std::vector<FrameRecord> m_pending;
+    std::condition_variable m_flushCondition;
+    uint64_t m_flushRequested = 0;
+    uint64_t m_flushCompleted = 0;
+    bool m_stopping = false;
+    // Set by the writer thread once a write fails, later records are dropped
+    HRESULT m_error = S_OK;
+    bool m_errorReported = false;
+    std::thread m_thread;
+};
+
+// Emits each record as a TraceLogging event so runs can be lined up with DWM
+// events in WPA. Provider name is "CaptureRateTest".
+class TraceLoggingSink : public ResultsSink
+{
+public:
+    TraceLoggingSink();
+    ~TraceLoggingSink() override;
+
+    void Write(FrameRecord const& record) override;
+};
+
+// Keeps every record, for comparing against a baseline once the run is over
+class MemorySink : public ResultsSink
+{
+public:
+    void Write(FrameRecord const& record) override;
+
+    std::vector<FrameRecord> Records();
+
+private:
+    std::mutex m_lock;
+    std::vector<FrameRecord> m_records;
+};
+
+std::shared_ptr<ResultsSink> CreateFileSinkFromPath(std::wstring const& path);
@@ -0,0 +1,272 @@
+﻿#include "pch.h"
+#include "Soak.h"
+#include "Timing.h"
+
+static constexpr double BytesPerMegabyte = 1024.0 * 1024.0;
+
+static ResourceSample SampleResources(IDXGIAdapter3* adapter)
+{
+    ResourceSample sample = {};
+
+    PROCESS_MEMORY_COUNTERS_EX memoryCounters = {};
+    memoryCounters.cb = sizeof(memoryCounters);
+    if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof(memoryCounters)))
+    {
+        sample.WorkingSetBytes = memoryCounters.WorkingSetSize;
+        sample.PrivateBytes = memoryCounters.PrivateUsage;
+    }
+
+    DWORD handleCount = 0;
+    if (GetProcessHandleCount(GetCurrentProcess(), &handleCount))
+    {
+        sample.HandleCount = handleCount;
+    }
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO videoMemoryInfo = {};
+    if (SUCCEEDED(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &videoMemoryInfo)))
+    {
+        sample.GpuLocalBytes = videoMemoryInfo.CurrentUsage;
+    }
+    if (SUCCEEDED(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &videoMemoryInfo)))
+    {
+        sample.GpuNonLocalBytes = videoMemoryInfo.CurrentUsage;
+    }
+    return sample;
+}
+
+static void PrintSampleHeader()
+{
+    wprintf(L"%10s %4s %8s %10s %10s %10s %10s %8s\n",
+        L"Elapsed", L"Gen", L"FPS", L"WS MB", L"Private MB", L"GPU MB", L"Shared MB", L"Handles");
+}
+
+static void PrintSample(ResourceSample const& sample)
+{
+    std::wstring fps = sample.BetweenSessions ? L"-" : std::to_wstring(static_cast<int64_t>(std::round(sample.FramesPerSecond)));
+    wprintf(L"%9.0fs %4u %8s %10.1f %10.1f %10.1f %10.1f %8u\n",
+        sample.ElapsedInSeconds,
+        sample.Generation,
+        fps.c_str(),
+        sample.WorkingSetBytes / BytesPerMegabyte,
+        sample.PrivateBytes / BytesPerMegabyte,
+        sample.GpuLocalBytes / BytesPerMegabyte,
+        sample.GpuNonLocalBytes / BytesPerMegabyte,
+        sample.HandleCount);
+}
+
+static void StartRunners(std::vector<std::unique_ptr<CaptureRunner>> const& runners)
+{
+    for (auto&& runner : runners)
+    {
+        runner->Start();
+    }
+}
+
+static void StopRunners(std::vector<std::unique_ptr<CaptureRunner>> const& runners)
+{
+    for (auto&& runner : runners)
+    {
+        runner->Stop();
+    }
+}
+
+std::vector<ResourceSample> RunSoak(SoakRunnerFactory const& createRunners, winrt::com_ptr<IDXGIAdapter3> const& adapter, SoakOptions const& options)
+{
+    wil::shared_event stopEvent(wil::EventOptions::ManualReset);
+    if (!options.DurationInSeconds.has_value())
+    {
+        // The reader is left behind if we stop for another reason, the
+        // process is about to exit anyway
+        wprintf(L"Press ENTER to stop...\n");
+        std::thread([stopEvent]()
+            {
+                std::wstring tempString;
+                std::getline(std::wcin, tempString);
+                stopEvent.SetEvent();
+            }).detach();
+    }
+
+    std::vector<ResourceSample> samples;
+    auto startQpc = GetQpcNow();
+    auto elapsedInSeconds = [startQpc]() { return QpcToSeconds(GetQpcNow() - startQpc); };
+
+    uint32_t generation = 0;
+    auto runners = createRunners(generation);
+    StartRunners(runners);
+    auto generationStartQpc = GetQpcNow();
+
+    PrintSampleHeader();
+    while (true)
+    {
+        auto stopped = stopEvent.wait(options.SampleIntervalInSeconds * 1000);
+
+        auto sample = SampleResources(adapter.get());
+        sample.ElapsedInSeconds = elapsedInSeconds();
+        sample.Generation = generation;
+        for (auto&& runner : runners)
+        {
+            sample.FramesPerSecond += runner->Summarize().FramesPerSecond;
+            runner->ResetStats();
+        }
+        samples.push_back(sample);
+        PrintSample(sample);
+
+        if (stopped || (options.DurationInSeconds.has_value() && sample.ElapsedInSeconds >= options.DurationInSeconds.value()))
+        {
+            break;
+        }
+
+        if (options.RecycleIntervalInMinutes.has_value() &&
+            QpcToSeconds(GetQpcNow() - generationStartQpc) >= options.RecycleIntervalInMinutes.value() * 60.0)
+        {
+            StopRunners(runners);
+            runners.clear();
+
+            auto idleSample = SampleResources(adapter.get());
+            idleSample.ElapsedInSeconds = elapsedInSeconds();
+            idleSample.Generation = generation;
+            idleSample.BetweenSessions = true;
+            samples.push_back(idleSample);
+            PrintSample(idleSample);
+
+            generation++;
+            runners = createRunners(generation);
+            StartRunners(runners);
+            generationStartQpc = GetQpcNow();
+        }
+    }
+    StopRunners(runners);
+    return samples;
+}
+
+struct SoakMetric
+{
+    wchar_t const* Name;
+    std::function<double(ResourceSample const&)> Value;
+};
+
+struct MetricTrend
+{
+    double First;
+    double Last;
+    double Max;
+    double SlopePerHour;
+    bool Growing;
+};
+
+static MetricTrend GetTrend(std::vector<ResourceSample const*> const& samples, SoakMetric const& metric)
+{
+    MetricTrend trend = {};
+    if (samples.empty())
+    {
+        return trend;
+    }
+    trend.First = metric.Value(*samples.front());
+    trend.Last = metric.Value(*samples.back());
+
+    // Least squares slope, and how often the value went up or stayed flat
+    double sumX = 0.0;
+    double sumY = 0.0;
+    double sumXX = 0.0;
+    double sumXY = 0.0;
+    size_t nonDecreasing = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        auto x = samples[i]->ElapsedInSeconds / 3600.0;
+        auto y = metric.Value(*samples[i]);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+        trend.Max = std::max(trend.Max, y);
+        if (i > 0 && y >= metric.Value(*samples[i - 1]))
+        {
+            nonDecreasing++;
+        }
+    }
+    auto count = static_cast<double>(samples.size());
+    auto denominator = (count * sumXX) - (sumX * sumX);
+    if (denominator > 0.0)
+    {
+        trend.SlopePerHour = ((count * sumXY) - (sumX * sumY)) / denominator;
+    }
+
+    // Steady growth rather than noise: nearly every step goes up and the
+    // total is more than 1% of where we started
+    if (samples.size() >= 3)
+    {
+        auto steps = static_cast<double>(samples.size() - 1);
+        auto mostlyIncreasing = static_cast<double>(nonDecreasing) / steps >= 0.9;
+        auto significant = (trend.Last - trend.First) > std::abs(trend.First) * 0.01;
+        trend.Growing = trend.SlopePerHour > 0.0 && mostlyIncreasing && significant;
+    }
+    return trend;
+}
+
+static bool PrintTrends(wchar_t const* title, std::vector<ResourceSample const*> const& samples, std::vector<SoakMetric> const& metrics)
+{
+    bool anyGrowing = false;
+    wprintf(L"%s (%zu samples):\n", title, samples.size());
+    wprintf(L"  %-16s %10s %10s %10s %12s %8s\n", L"", L"first", L"last", L"max", L"per hour", L"trend");
+    for (auto&& metric : metrics)
+    {
+        auto trend = GetTrend(samples, metric);
+        anyGrowing |= trend.Growing;
+        wprintf(L"  %-16s %10.1f %10.1f %10.1f %+12.2f %8s\n",
+            metric.Name,
+            trend.First,
+            trend.Last,
+            trend.Max,
+            trend.SlopePerHour,
+            trend.Growing ? L"GROWING" : L"flat");
+    }
+    return anyGrowing;
+}
+
+bool PrintSoakReport(std::vector<ResourceSample> const& samples)
+{
+    std::vector<SoakMetric> metrics =
+    {
+        { L"Working set MB", [](auto const& sample) { return sample.WorkingSetBytes / BytesPerMegabyte; } },
+        { L"Private MB", [](auto const& sample) { return sample.PrivateBytes / BytesPerMegabyte; } },
+        { L"GPU local MB", [](auto const& sample) { return sample.GpuLocalBytes / BytesPerMegabyte; } },
+        { L"GPU shared MB", [](auto const& sample) { return sample.GpuNonLocalBytes / BytesPerMegabyte; } },
+        { L"Handles", [](auto const& sample) { return static_cast<double>(sample.HandleCount); } },
+    };
+
+    std::vector<ResourceSample const*> sessionSamples;
+    std::vector<ResourceSample const*> idleSamples;
+    for (auto&& sample : samples)
+    {
+        (sample.BetweenSessions ? idleSamples : sessionSamples).push_back(&sample);
+    }
+
+    wprintf(L"\n");
+    auto growingWhileCapturing = PrintTrends(L"While capturing", sessionSamples, metrics);
+    auto growingBetweenSessions = false;
+    if (idleSamples.size() >= 2)
+    {
+        wprintf(L"\n");
+        growingBetweenSessions = PrintTrends(L"Between sessions", idleSamples, metrics);
+    }
+
+    wprintf(L"\n");
+    if (growingBetweenSessions)
+    {
+        // Growth that survived tearing every session down
+        wprintf(L"Resources grow across session recycles, looks like a per-process leak.\n");
+    }
+    else if (growingWhileCapturing && idleSamples.size() >= 2)
+    {
+        wprintf(L"Resources grow while capturing but are released with the session.\n");
+    }
+    else if (growingWhileCapturing)
+    {
+        wprintf(L"Resources grow while capturing, use 'recycle' to tell session and process leaks apart.\n");
+    }
+    else
+    {
+        wprintf(L"No steady growth detected.\n");
+    }
+    return growingWhileCapturing || growingBetweenSessions;
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "CaptureRunner.h"
+
+struct SoakOptions
+{
+    uint32_t SampleIntervalInSeconds = 60;
+    // Tear down and recreate the sessions this often, if set
+    std::optional<uint32_t> RecycleIntervalInMinutes;
+    // Wait for ENTER when unset
+    std::optional<uint32_t> DurationInSeconds;
+};
+
+struct ResourceSample
+{
+    double ElapsedInSeconds;
+    // Incremented every time the sessions are recycled
+    uint32_t Generation;
+    // Taken between stopping one generation and starting the next, so no
+    // sessions were alive
+    bool BetweenSessions;
+    double FramesPerSecond;
+    uint64_t WorkingSetBytes;
+    uint64_t PrivateBytes;
+    uint64_t GpuLocalBytes;
+    uint64_t GpuNonLocalBytes;
+    uint32_t HandleCount;
+};
+
+// Creates and starts the sessions for a generation
+using SoakRunnerFactory = std::function<std::vector<std::unique_ptr<CaptureRunner>>(uint32_t generation)>;
+
+// Keeps capture running for a long time, sampling process and GPU memory,
+// handle count and fps. Recycling the sessions separates leaks that go
+// away with the session from ones that stay with the process.
+std::vector<ResourceSample> RunSoak(SoakRunnerFactory const& createRunners, winrt::com_ptr<IDXGIAdapter3> const& adapter, SoakOptions const& options);
+// Returns true if any metric grew steadily
+bool PrintSoakReport(std::vector<ResourceSample> const& samples);
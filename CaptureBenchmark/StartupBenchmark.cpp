@@ -0,0 +1,100 @@
+﻿#include "pch.h"
+#include "StartupBenchmark.h"
+#include "Timing.h"
+
+namespace winrt
+{
+    using namespace Windows::Graphics::DirectX::Direct3D11;
+}
+
+// The first frame is delivered right after StartCapture, even for static content
+static constexpr std::chrono::milliseconds FirstFrameTimeout = std::chrono::seconds(5);
+
+StartupSummary RunStartupBenchmark(
+    CaptureItemSource const& source,
+    CaptureConfig const& config,
+    uint32_t iterations,
+    bool coldDevice,
+    CaptureDeviceFactory const& createDevice)
+{
+    Histogram createDeviceTime;
+    Histogram createItemTime;
+    Histogram createFramePoolTime;
+    Histogram createSessionTime;
+    Histogram startCaptureTime;
+    Histogram firstFrameTime;
+    Histogram timeToFirstFrame;
+    uint32_t timeouts = 0;
+
+    winrt::IDirect3DDevice sharedDevice{ nullptr };
+    if (!coldDevice)
+    {
+        sharedDevice = createDevice();
+        CaptureRunner runner(sharedDevice, source, config);
+        runner.Start();
+        runner.WaitForFirstFrame(FirstFrameTimeout);
+        runner.Stop();
+    }
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        int64_t createDeviceQpc = 0;
+        auto device = sharedDevice;
+        if (coldDevice)
+        {
+            auto deviceStartQpc = GetQpcNow();
+            device = createDevice();
+            createDeviceQpc = GetQpcNow() - deviceStartQpc;
+            createDeviceTime.Record(QpcToMicroseconds(createDeviceQpc));
+        }
+
+        CaptureRunner runner(device, source, config);
+        runner.Start();
+        auto gotFrame = runner.WaitForFirstFrame(FirstFrameTimeout);
+        runner.Stop();
+
+        auto timings = runner.GetStartupTimings();
+        createItemTime.Record(QpcToMicroseconds(timings.CreateItemQpc));
+        createFramePoolTime.Record(QpcToMicroseconds(timings.CreateFramePoolQpc));
+        createSessionTime.Record(QpcToMicroseconds(timings.CreateSessionQpc));
+        startCaptureTime.Record(QpcToMicroseconds(timings.StartCaptureQpc));
+        if (gotFrame)
+        {
+            firstFrameTime.Record(QpcToMicroseconds(timings.FirstFrameQpc));
+            timeToFirstFrame.Record(QpcToMicroseconds(createDeviceQpc + timings.FirstFrameQpc));
+        }
+        else
+        {
+            timeouts++;
+        }
+    }
+
+    StartupSummary summary = {};
+    summary.Iterations = iterations;
+    summary.Timeouts = timeouts;
+    summary.CreateDevice = createDeviceTime.Summarize();
+    summary.CreateItem = createItemTime.Summarize();
+    summary.CreateFramePool = createFramePoolTime.Summarize();
+    summary.CreateSession = createSessionTime.Summarize();
+    summary.StartCapture = startCaptureTime.Summarize();
+    summary.FirstFrame = firstFrameTime.Summarize();
+    summary.TimeToFirstFrame = timeToFirstFrame.Summarize();
+    return summary;
+}
+
+void PrintStartupSummary(std::wstring const& label, StartupSummary const& summary)
+{
+    wprintf(L"Startup (%s, %u iterations):\n", label.c_str(), summary.Iterations);
+    PrintHistogramHeader(L"(ms)");
+    PrintHistogramRow(L"Create device", summary.CreateDevice);
+    PrintHistogramRow(L"Create item", summary.CreateItem);
+    PrintHistogramRow(L"Create frame pool", summary.CreateFramePool);
+    PrintHistogramRow(L"Create session", summary.CreateSession);
+    PrintHistogramRow(L"StartCapture", summary.StartCapture);
+    PrintHistogramRow(L"First FrameArrived", summary.FirstFrame);
+    PrintHistogramRow(L"Time to first frame", summary.TimeToFirstFrame);
+    if (summary.Timeouts > 0)
+    {
+        wprintf(L"  %u iterations timed out waiting for a frame.\n", summary.Timeouts);
+    }
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "CaptureItemSource.h"
+#include "CaptureRunner.h"
+
+// All histogram values are in microseconds
+struct StartupSummary
+{
+    uint32_t Iterations;
+    // Iterations that never got a frame
+    uint32_t Timeouts;
+    // Only recorded when each iteration creates its own device
+    HistogramSummary CreateDevice;
+    HistogramSummary CreateItem;
+    HistogramSummary CreateFramePool;
+    HistogramSummary CreateSession;
+    HistogramSummary StartCapture;
+    HistogramSummary FirstFrame;
+    // Device creation (if any) through the first frame
+    HistogramSummary TimeToFirstFrame;
+};
+
+using CaptureDeviceFactory = std::function<winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice()>;
+
+// Starts a session, waits for its first frame and tears it down again, once
+// per iteration. A cold device is created for every iteration, otherwise one
+// device is shared and primed with an iteration that isn't measured.
+StartupSummary RunStartupBenchmark(
+    CaptureItemSource const& source,
+    CaptureConfig const& config,
+    uint32_t iterations,
+    bool coldDevice,
+    CaptureDeviceFactory const& createDevice);
+
+void PrintStartupSummary(std::wstring const& label, StartupSummary const& summary);
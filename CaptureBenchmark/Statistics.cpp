@@ -0,0 +1,168 @@
+﻿#include "pch.h"
+#include "Statistics.h"
+
+SampleStatistics DescribeSamples(std::vector<double> const& samples)
+{
+    SampleStatistics result = {};
+    result.Count = samples.size();
+    if (samples.empty())
+    {
+        return result;
+    }
+    double sum = 0.0;
+    for (auto&& sample : samples)
+    {
+        sum += sample;
+    }
+    result.Mean = sum / static_cast<double>(samples.size());
+    if (samples.size() > 1)
+    {
+        double squares = 0.0;
+        for (auto&& sample : samples)
+        {
+            squares += (sample - result.Mean) * (sample - result.Mean);
+        }
+        result.StandardDeviation = std::sqrt(squares / static_cast<double>(samples.size() - 1));
+    }
+    return result;
+}
+
+// Continued fraction for the incomplete beta function, evaluated with the
+// modified Lentz method
+static double IncompleteBetaFraction(double a, double b, double x)
+{
+    constexpr int MaxIterations = 200;
+    constexpr double Epsilon = 1e-12;
+    constexpr double Tiny = 1e-300;
+
+    auto c = 1.0;
+    auto d = 1.0 - ((a + b) * x / (a + 1.0));
+    if (std::abs(d) < Tiny)
+    {
+        d = Tiny;
+    }
+    d = 1.0 / d;
+    auto result = d;
+    for (int m = 1; m <= MaxIterations; m++)
+    {
+        auto m2 = 2.0 * m;
+        auto numerator = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + (numerator * d);
+        d = std::abs(d) < Tiny ? Tiny : d;
+        c = 1.0 + (numerator / c);
+        c = std::abs(c) < Tiny ? Tiny : c;
+        d = 1.0 / d;
+        result *= d * c;
+
+        numerator = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + (numerator * d);
+        d = std::abs(d) < Tiny ? Tiny : d;
+        c = 1.0 + (numerator / c);
+        c = std::abs(c) < Tiny ? Tiny : c;
+        d = 1.0 / d;
+        auto delta = d * c;
+        result *= delta;
+        if (std::abs(delta - 1.0) < Epsilon)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+// The regularized incomplete beta function I_x(a, b)
+static double RegularizedIncompleteBeta(double a, double b, double x)
+{
+    if (x <= 0.0)
+    {
+        return 0.0;
+    }
+    if (x >= 1.0)
+    {
+        return 1.0;
+    }
+    auto logFront = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + (a * std::log(x)) + (b * std::log(1.0 - x));
+    auto front = std::exp(logFront);
+    // The fraction converges quickly on this side of the mean
+    if (x < (a + 1.0) / (a + b + 2.0))
+    {
+        return front * IncompleteBetaFraction(a, b, x) / a;
+    }
+    return 1.0 - (front * IncompleteBetaFraction(b, a, 1.0 - x) / b);
+}
+
+std::optional<WelchTestResult> WelchTTest(std::vector<double> const& first, std::vector<double> const& second)
+{
+    if (first.size() < 2 || second.size() < 2)
+    {
+        return std::nullopt;
+    }
+    auto a = DescribeSamples(first);
+    auto b = DescribeSamples(second);
+    auto varianceA = (a.StandardDeviation * a.StandardDeviation) / static_cast<double>(a.Count);
+    auto varianceB = (b.StandardDeviation * b.StandardDeviation) / static_cast<double>(b.Count);
+    auto varianceSum = varianceA + varianceB;
+    if (varianceSum <= 0.0)
+    {
+        return std::nullopt;
+    }
+
+    WelchTestResult result = {};
+    result.Difference = b.Mean - a.Mean;
+    result.T = result.Difference / std::sqrt(varianceSum);
+    // Welch-Satterthwaite
+    result.DegreesOfFreedom = (varianceSum * varianceSum) /
+        (((varianceA * varianceA) / static_cast<double>(a.Count - 1)) + ((varianceB * varianceB) / static_cast<double>(b.Count - 1)));
+    auto df = result.DegreesOfFreedom;
+    result.PValue = RegularizedIncompleteBeta(df / 2.0, 0.5, df / (df + (result.T * result.T)));
+    return result;
+}
+
+double SamplePercentile(std::vector<double>& samples, double percentile)
+{
+    auto rank = static_cast<size_t>(std::ceil((percentile / 100.0) * static_cast<double>(samples.size())));
+    auto index = std::clamp<size_t>(rank, 1, samples.size()) - 1;
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+ConfidenceInterval BootstrapDifference(
+    std::vector<double> const& first,
+    std::vector<double> const& second,
+    SampleStatistic const& statistic,
+    uint32_t iterations,
+    double confidence)
+{
+    ConfidenceInterval result = {};
+    auto firstCopy = first;
+    auto secondCopy = second;
+    result.Estimate = statistic(secondCopy) - statistic(firstCopy);
+
+    std::mt19937_64 random(0x5eed);
+    std::uniform_int_distribution<size_t> pickFirst(0, first.size() - 1);
+    std::uniform_int_distribution<size_t> pickSecond(0, second.size() - 1);
+    std::vector<double> differences;
+    differences.reserve(iterations);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (auto&& sample : firstCopy)
+        {
+            sample = first[pickFirst(random)];
+        }
+        for (auto&& sample : secondCopy)
+        {
+            sample = second[pickSecond(random)];
+        }
+        differences.push_back(statistic(secondCopy) - statistic(firstCopy));
+    }
+    if (differences.empty())
+    {
+        result.Lower = result.Estimate;
+        result.Upper = result.Estimate;
+        return result;
+    }
+    auto tail = (1.0 - confidence) * 50.0;
+    result.Lower = SamplePercentile(differences, tail);
+    result.Upper = SamplePercentile(differences, 100.0 - tail);
+    return result;
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+struct SampleStatistics
+{
+    size_t Count;
+    double Mean;
+    // Sample standard deviation, zero with fewer than two samples
+    double StandardDeviation;
+};
+
+SampleStatistics DescribeSamples(std::vector<double> const& samples);
+
+struct WelchTestResult
+{
+    // Mean of the second sample minus the mean of the first
+    double Difference;
+    double T;
+    double DegreesOfFreedom;
+    // Two-sided
+    double PValue;
+};
+
+// Welch's t-test, which doesn't assume the two samples share a variance.
+// Empty with fewer than two samples on either side or no variance at all.
+std::optional<WelchTestResult> WelchTTest(std::vector<double> const& first, std::vector<double> const& second);
+
+// Percentile is in [0, 100]. Reorders the samples, which can't be empty.
+double SamplePercentile(std::vector<double>& samples, double percentile);
+
+struct ConfidenceInterval
+{
+    double Estimate;
+    double Lower;
+    double Upper;
+};
+
+// Computes a statistic over samples, and is free to reorder them
+using SampleStatistic = std::function<double(std::vector<double>&)>;
+
+// Percentile bootstrap of statistic(second) minus statistic(first), each
+// side resampled with replacement. Uses a fixed seed so the same inputs
+// always give the same interval. Neither side can be empty.
+ConfidenceInterval BootstrapDifference(
+    std::vector<double> const& first,
+    std::vector<double> const& second,
+    SampleStatistic const& statistic,
+    uint32_t iterations = 1000,
+    double confidence = 0.95);
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+// SystemRelativeTime and other WinRT TimeSpan values are in 100ns units
+// relative to the same clock as QueryPerformanceCounter.
+constexpr int64_t HundredNanosecondsPerSecond = 10'000'000;
+
+inline int64_t GetQpcFrequency()
+{
+    static const int64_t frequency = []()
+    {
+        LARGE_INTEGER value = {};
+        winrt::check_bool(QueryPerformanceFrequency(&value));
+        return value.QuadPart;
+    }();
+    return frequency;
+}
+
+inline int64_t GetQpcNow()
+{
+    LARGE_INTEGER value = {};
+    QueryPerformanceCounter(&value);
+    return value.QuadPart;
+}
+
+// Split the conversion so large counter values don't overflow
+inline int64_t QpcToHundredNanoseconds(int64_t qpc)
+{
+    auto frequency = GetQpcFrequency();
+    auto whole = qpc / frequency;
+    auto part = qpc % frequency;
+    return (whole * HundredNanosecondsPerSecond) + ((part * HundredNanosecondsPerSecond) / frequency);
+}
+
+inline int64_t QpcToMicroseconds(int64_t qpc)
+{
+    return QpcToHundredNanoseconds(qpc) / 10;
+}
+
+inline int64_t HundredNanosecondsToQpc(int64_t value)
+{
+    auto frequency = GetQpcFrequency();
+    auto whole = value / HundredNanosecondsPerSecond;
+    auto part = value % HundredNanosecondsPerSecond;
+    return (whole * frequency) + ((part * frequency) / HundredNanosecondsPerSecond);
+}
+
+inline double QpcToSeconds(int64_t qpc)
+{
+    return static_cast<double>(qpc) / static_cast<double>(GetQpcFrequency());
+}
@@ -0,0 +1,212 @@
+﻿#include "pch.h"
+#include "UtilizationSampler.h"
+#include "Timing.h"
+
+static std::optional<DWORD> FindProcessIdByName(std::wstring const& name)
+{
+    wil::unique_handle snapshot(CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0));
+    if (!snapshot.is_valid())
+    {
+        return std::nullopt;
+    }
+    PROCESSENTRY32W entry = {};
+    entry.dwSize = sizeof(entry);
+    for (auto found = Process32FirstW(snapshot.get(), &entry); found; found = Process32NextW(snapshot.get(), &entry))
+    {
+        if (_wcsicmp(entry.szExeFile, name.c_str()) == 0)
+        {
+            return std::optional(entry.th32ProcessID);
+        }
+    }
+    return std::nullopt;
+}
+
+// Kernel plus user time, in 100ns units
+static uint64_t GetProcessCpuTime(HANDLE process)
+{
+    FILETIME creationTime = {};
+    FILETIME exitTime = {};
+    FILETIME kernelTime = {};
+    FILETIME userTime = {};
+    if (process == nullptr || !GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        return 0;
+    }
+    auto toTicks = [](FILETIME const& time) { return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+    return toTicks(kernelTime) + toTicks(userTime);
+}
+
+// Instances look like "pid_1234_luid_0x00000000_0x0000C4F2_phys_0_eng_0_engtype_3D"
+static std::optional<std::pair<DWORD, std::wstring>> ParseGpuEngineInstance(std::wstring const& instance)
+{
+    if (instance.rfind(L"pid_", 0) != 0)
+    {
+        return std::nullopt;
+    }
+    auto engineType = instance.find(L"engtype_");
+    if (engineType == std::wstring::npos)
+    {
+        return std::nullopt;
+    }
+    auto processId = static_cast<DWORD>(wcstoul(instance.c_str() + 4, nullptr, 10));
+    return std::optional(std::make_pair(processId, instance.substr(engineType + 8)));
+}
+
+UtilizationSampler::UtilizationSampler(std::chrono::milliseconds interval) : m_interval(interval)
+{
+    m_processId = GetCurrentProcessId();
+    if (auto dwmProcessId = FindProcessIdByName(L"dwm.exe"))
+    {
+        m_dwmProcessId = dwmProcessId.value();
+        // Limited information is all GetProcessTimes needs
+        m_dwmProcess.reset(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, m_dwmProcessId));
+    }
+
+    // The GPU engine counters are missing on older builds and some drivers,
+    // the rest of the sampling still works without them
+    PDH_HQUERY query = nullptr;
+    if (PdhOpenQueryW(nullptr, 0, &query) == ERROR_SUCCESS)
+    {
+        m_query.reset(query);
+        if (PdhAddEnglishCounterW(m_query.get(), L"\\GPU Engine(*)\\Utilization Percentage", 0, &m_gpuCounter) != ERROR_SUCCESS)
+        {
+            m_gpuCounter = nullptr;
+        }
+    }
+}
+
+UtilizationSampler::~UtilizationSampler()
+{
+    m_stopEvent.SetEvent();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void UtilizationSampler::Start()
+{
+    m_startQpc = GetQpcNow();
+    m_startProcessCpu = GetProcessCpuTime(GetCurrentProcess());
+    m_startDwmCpu = GetProcessCpuTime(m_dwmProcess.get());
+    if (m_gpuCounter != nullptr)
+    {
+        // Rate counters need a first collection to diff against
+        PdhCollectQueryData(m_query.get());
+    }
+    m_thread = std::thread([this]() { Run(); });
+}
+
+UtilizationSummary UtilizationSampler::Stop()
+{
+    m_stopEvent.SetEvent();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    UtilizationSummary summary = {};
+    summary.Sampled = true;
+    summary.DurationInSeconds = QpcToSeconds(GetQpcNow() - m_startQpc);
+    summary.ProcessCpuSeconds = static_cast<double>(GetProcessCpuTime(GetCurrentProcess()) - m_startProcessCpu) / HundredNanosecondsPerSecond;
+    if (m_dwmProcess.is_valid())
+    {
+        summary.DwmCpuAvailable = true;
+        summary.DwmCpuSeconds = static_cast<double>(GetProcessCpuTime(m_dwmProcess.get()) - m_startDwmCpu) / HundredNanosecondsPerSecond;
+    }
+    if (m_gpuSampleCount > 0)
+    {
+        summary.GpuAvailable = true;
+        summary.GpuPercent = m_gpuTotals.Total / m_gpuSampleCount;
+        summary.GpuPeakPercent = m_gpuPeak;
+        summary.ProcessGpuPercent = m_gpuTotals.Process / m_gpuSampleCount;
+        summary.DwmGpuPercent = m_gpuTotals.Dwm / m_gpuSampleCount;
+    }
+    return summary;
+}
+
+void UtilizationSampler::Run()
+{
+    // Lower than the capture threads, sampling shouldn't compete with them
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    while (!m_stopEvent.wait(static_cast<DWORD>(m_interval.count())))
+    {
+        if (auto sample = SampleGpu())
+        {
+            m_gpuSampleCount++;
+            m_gpuTotals.Total += sample->Total;
+            m_gpuTotals.Process += sample->Process;
+            m_gpuTotals.Dwm += sample->Dwm;
+            m_gpuPeak = std::max(m_gpuPeak, sample->Total);
+        }
+    }
+}
+
+std::optional<UtilizationSampler::GpuSample> UtilizationSampler::SampleGpu()
+{
+    if (m_gpuCounter == nullptr || PdhCollectQueryData(m_query.get()) != ERROR_SUCCESS)
+    {
+        return std::nullopt;
+    }
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+    auto status = PdhGetFormattedCounterArrayW(m_gpuCounter, PDH_FMT_DOUBLE, &bufferSize, &itemCount, nullptr);
+    if (status != PDH_MORE_DATA)
+    {
+        return std::nullopt;
+    }
+    std::vector<uint8_t> buffer(bufferSize);
+    auto items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM_W*>(buffer.data());
+    if (PdhGetFormattedCounterArrayW(m_gpuCounter, PDH_FMT_DOUBLE, &bufferSize, &itemCount, items) != ERROR_SUCCESS)
+    {
+        return std::nullopt;
+    }
+
+    // Engines of the same type add up across processes, the GPU is as busy
+    // as its busiest engine type
+    struct EngineTotals
+    {
+        double Total;
+        double Process;
+        double Dwm;
+    };
+    std::vector<std::pair<std::wstring, EngineTotals>> engines;
+    for (DWORD i = 0; i < itemCount; i++)
+    {
+        auto const& item = items[i];
+        if (item.FmtValue.CStatus != PDH_CSTATUS_VALID_DATA && item.FmtValue.CStatus != PDH_CSTATUS_NEW_DATA)
+        {
+            continue;
+        }
+        auto parsed = ParseGpuEngineInstance(item.szName);
+        if (!parsed.has_value())
+        {
+            continue;
+        }
+        auto [processId, engineType] = parsed.value();
+        auto engine = std::find_if(engines.begin(), engines.end(), [&engineType](auto const& entry) { return entry.first == engineType; });
+        if (engine == engines.end())
+        {
+            engine = engines.insert(engines.end(), { engineType, {} });
+        }
+        auto value = item.FmtValue.doubleValue;
+        engine->second.Total += value;
+        if (processId == m_processId)
+        {
+            engine->second.Process += value;
+        }
+        else if (processId == m_dwmProcessId)
+        {
+            engine->second.Dwm += value;
+        }
+    }
+
+    GpuSample sample = {};
+    for (auto&& [engineType, totals] : engines)
+    {
+        sample.Total = std::max(sample.Total, std::min(totals.Total, 100.0));
+        sample.Process = std::max(sample.Process, std::min(totals.Process, 100.0));
+        sample.Dwm = std::max(sample.Dwm, std::min(totals.Dwm, 100.0));
+    }
+    return std::optional(sample);
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+struct UtilizationSummary
+{
+    // False if the run wasn't sampled
+    bool Sampled;
+    double DurationInSeconds;
+    // CPU time across all threads, so more than a second per second is
+    // possible
+    double ProcessCpuSeconds;
+    // False if the DWM couldn't be opened, usually because we aren't elevated
+    bool DwmCpuAvailable;
+    double DwmCpuSeconds;
+    // False if the GPU engine counters couldn't be queried
+    bool GpuAvailable;
+    // Percent of the busiest engine type, like Task Manager. Averaged over
+    // the run, and the busiest sample.
+    double GpuPercent;
+    double GpuPeakPercent;
+    // The engine time used by our process and the DWM, on the same scale
+    double ProcessGpuPercent;
+    double DwmGpuPercent;
+};
+
+// Samples our own and the DWM's CPU time, and GPU engine utilization through
+// the "\GPU Engine(*)\Utilization Percentage" PDH counters, on a background
+// thread while a run is being measured.
+class UtilizationSampler
+{
+public:
+    UtilizationSampler(std::chrono::milliseconds interval = std::chrono::seconds(1));
+    ~UtilizationSampler();
+    UtilizationSampler(UtilizationSampler const&) = delete;
+    UtilizationSampler& operator=(UtilizationSampler const&) = delete;
+
+    void Start();
+    UtilizationSummary Stop();
+
+private:
+    struct GpuSample
+    {
+        double Total;
+        double Process;
+        double Dwm;
+    };
+
+    void Run();
+    std::optional<GpuSample> SampleGpu();
+
+private:
+    std::chrono::milliseconds m_interval;
+    DWORD m_processId = 0;
+    DWORD m_dwmProcessId = 0;
+    wil::unique_handle m_dwmProcess;
+    wil::unique_any<PDH_HQUERY, decltype(&PdhCloseQuery), PdhCloseQuery> m_query;
+    PDH_HCOUNTER m_gpuCounter = nullptr;
+
+    std::thread m_thread;
+    wil::unique_event m_stopEvent{ wil::EventOptions::ManualReset };
+    int64_t m_startQpc = 0;
+    uint64_t m_startProcessCpu = 0;
+    uint64_t m_startDwmCpu = 0;
+    // Written by the sampling thread, read once it has exited
+    uint32_t m_gpuSampleCount = 0;
+    GpuSample m_gpuTotals = {};
+    double m_gpuPeak = 0.0;
+};
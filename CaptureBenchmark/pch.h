@@ -0,0 +1,81 @@
+﻿#pragma once
+
+// Windows
+#include <windows.h>
+#include <dwmapi.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#include <pdh.h>
+#include <pdhmsg.h>
+
+// Must come before C++/WinRT
+#include <wil/cppwinrt.h>
+
+// WinRT
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Foundation.Metadata.h>
+#include <winrt/Windows.Foundation.Numerics.h>
+#include <winrt/Windows.System.h>
+#include <winrt/Windows.UI.h>
+#include <winrt/Windows.UI.Composition.h>
+#include <winrt/Windows.UI.Composition.Desktop.h>
+#include <winrt/Windows.UI.Popups.h>
+#include <winrt/Windows.Graphics.Capture.h>
+#include <winrt/Windows.Graphics.DirectX.h>
+#include <winrt/Windows.Graphics.DirectX.Direct3d11.h>
+
+// WIL
+#include <wil/resource.h>
+
+// DirectX
+#include <d3d11_4.h>
+#include <dxgi1_6.h>
+#include <d2d1_3.h>
+#include <wincodec.h>
+#include <d3dcompiler.h>
+
+// Media Foundation
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <mferror.h>
+#include <strmif.h>
+#include <codecapi.h>
+
+// STL
+#include <vector>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <variant>
+#include <optional>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <future>
+#include <random>
+#include <fstream>
+#include <unordered_set>
+#include <deque>
+
+// robmikh.common
+#include <robmikh.common/composition.interop.h>
+#include <robmikh.common/direct3d11.interop.h>
+#include <robmikh.common/d3dHelpers.h>
+#include <robmikh.common/graphics.interop.h>
+#include <robmikh.common/dispatcherqueue.desktop.interop.h>
+#include <robmikh.common/d3dHelpers.desktop.h>
+#include <robmikh.common/composition.desktop.interop.h>
+#include <robmikh.common/hwnd.interop.h>
+#include <robmikh.common/capture.desktop.interop.h>
+#include <robmikh.common/DesktopWindow.h>
+#include <robmikh.common/wcliparse.h>
+#include <robmikh.common/WindowInfo.h>
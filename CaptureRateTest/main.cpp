@@ -1,4 +1,20 @@
 ﻿#include "pch.h"
+#include "AbTest.h"
+#include "Adapters.h"
+#include "Baseline.h"
+#include "CaptureBenchmark.h"
+#include "CaptureItemSource.h"
+#include "CaptureRunner.h"
+#include "CaptureStats.h"
+#include "ContentGenerator.h"
+#include "Enumeration.h"
+#include "LiveStats.h"
+#include "PixelFormat.h"
+#include "Ramp.h"
+#include "ResultsSink.h"
+#include "Soak.h"
+#include "StartupBenchmark.h"
+#include "Timing.h"
 
 namespace winrt
 {
@@ -19,9 +35,6 @@ namespace util
     using namespace robmikh::common::wcli;
 }
 
-template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
-
 struct MonitorCaptureSubject
 {
     uint32_t MonitorIndex;
@@ -30,35 +43,103 @@ struct MonitorCaptureSubject
 struct WindowCaptureSubject
 {
     std::wstring TitleQuery;
+    // Used to pick between multiple matches without prompting
+    std::optional<uint32_t> WindowIndex;
+    std::optional<DWORD> ProcessId;
+};
+
+struct WindowHandleCaptureSubject
+{
+    HWND Window;
 };
 
-typedef std::variant<MonitorCaptureSubject, WindowCaptureSubject> CaptureSubject;
+typedef std::variant<MonitorCaptureSubject, WindowCaptureSubject, WindowHandleCaptureSubject> CaptureSubject;
 
-struct Options
+struct LabeledCaptureConfig
 {
-    CaptureSubject Subject;
-    uint32_t IntervalInMs;
-    bool NoBorder;
+    std::wstring Label;
+    CaptureConfig Config;
 };
 
-struct MonitorCaptureItemSource
+// A value along one dimension of a comparison, e.g. a buffer count
+struct ConfigVariant
 {
-    HMONITOR Monitor;
+    std::wstring Label;
+    std::function<void(CaptureConfig&)> Apply;
 };
 
-struct WindowCaptureItemSource
+// Configurations that are run one after another and compared in a table
+struct MatrixOptions
 {
-    HWND Window;
+    std::vector<LabeledCaptureConfig> Configs;
+    uint32_t DurationInSeconds;
+};
+
+// Configurations that are run in interleaved windows and compared against
+// the first one
+struct AbTestPlan
+{
+    std::vector<LabeledCaptureConfig> Configs;
+    AbTestOptions Test;
+};
+
+// A previous run's per-frame records to compare this one against
+struct BaselinePlan
+{
+    std::wstring Path;
+    BaselineOptions Comparison;
 };
 
-typedef std::variant<MonitorCaptureItemSource, WindowCaptureItemSource> CaptureItemSource;
+struct Options
+{
+    std::vector<CaptureSubject> Subjects;
+    CaptureConfig Config;
+    RunOptions Run;
+    std::optional<MatrixOptions> Matrix;
+    std::optional<AbTestPlan> AbTest;
+    // Measure session startup instead of capture rate
+    std::optional<uint32_t> StartupIterations;
+    // Track resource growth over a long run instead of reporting capture rate
+    std::optional<SoakOptions> Soak;
+    // Find the shortest interval each subject keeps up with
+    std::optional<RampOptions> Ramp;
+    // Capture a window we render ourselves, in addition to any other subjects
+    std::optional<ContentOptions> Content;
+    std::optional<BaselinePlan> Baseline;
+    std::wstring OutputPath;
+    // Shared memory name to publish live stats under
+    std::wstring LiveStatsName;
+    // Poll another instance's live stats instead of capturing
+    std::wstring WatchName;
+    // Every monitor is added to the subjects once they're enumerated
+    bool AllMonitors;
+    bool Etw;
+    // Print the enumeration snapshot and exit
+    bool List;
+};
 
 std::optional<Options> ParseOptions(int argc, wchar_t* argv[], bool& error);
-std::optional<util::WindowInfo> GetWindowToCapture(std::vector<util::WindowInfo> const& windows);
-std::optional<CaptureItemSource> CreateItemSourceFromSubject(CaptureSubject captureSubject);
-std::optional<CaptureItemSource> CreateCaptureSourceFromMonitorIndex(uint32_t monitorIndex);
-std::optional<CaptureItemSource> CreateCaptureSourceFromWindowTitleSearch(std::wstring const& titleQuery);
-winrt::GraphicsCaptureItem CreateCaptureItemFromSource(CaptureItemSource itemSource);
+std::optional<WindowEntry> GetWindowToCapture(std::vector<WindowEntry> const& windows, std::optional<uint32_t> windowIndex, bool interactive);
+std::optional<CaptureItemSource> CreateItemSourceFromSubject(EnumerationSnapshot const& snapshot, CaptureSubject captureSubject, bool interactive);
+std::optional<CaptureItemSource> CreateCaptureSourceFromMonitorIndex(EnumerationSnapshot const& snapshot, uint32_t monitorIndex);
+std::optional<CaptureItemSource> CreateCaptureSourceFromWindowSearch(EnumerationSnapshot const& snapshot, WindowCaptureSubject const& subject, bool interactive);
+std::optional<CaptureItemSource> CreateCaptureSourceFromWindowHandle(HWND window);
+std::optional<std::vector<std::shared_ptr<ResultsSink>>> CreateResultsSinks(Options const& options);
+void RunStartupBenchmarks(CaptureItemSource const& source, CaptureConfig const& config, uint32_t iterations);
+bool RunSoakTest(std::vector<CaptureItemSource> const& sources, CaptureConfig const& config, SoakOptions const& soakOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks);
+void RunRampTest(std::vector<CaptureItemSource> const& sources, CaptureConfig const& config, RampOptions const& rampOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks);
+bool WatchLiveStats(std::wstring const& name);
+MultiCaptureSummary RunBenchmark(winrt::IDirect3DDevice const& device, std::vector<CaptureItemSource> const& sources, CaptureConfig const& config, RunOptions const& runOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks);
+bool MeetsMinimumFramesPerSecond(std::vector<LabeledCaptureSummary> const& summaries, RunOptions const& runOptions);
+std::vector<LabeledCaptureSummary> RunMatrix(std::vector<CaptureItemSource> const& sources, MatrixOptions const& matrix, RunOptions const& runOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks);
+void RunAbComparison(std::vector<CaptureItemSource> const& sources, AbTestPlan const& plan, RunOptions const& runOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks);
+
+// Returned when a run completes but falls below '-minFps'
+constexpr int BelowMinimumFramesPerSecondExitCode = 2;
+// Returned when a soak run sees steady resource growth
+constexpr int ResourceGrowthExitCode = 3;
+// Returned when fps or p99 latency regress compared to '-baseline'
+constexpr int RegressionExitCode = 4;
 
 int __stdcall wmain(int argc, wchar_t* argv[])
 {
@@ -72,119 +153,406 @@ int __stdcall wmain(int argc, wchar_t* argv[])
     {
         return error ? 1 : 0;
     }
-    uint32_t interval = options->IntervalInMs;
-    auto sourceOpt = CreateItemSourceFromSubject(options->Subject);
-    if (!sourceOpt.has_value())
+    if (!options->WatchName.empty())
+    {
+        return WatchLiveStats(options->WatchName) ? 0 : 1;
+    }
+    // Taken once, sessions created later don't enumerate again
+    auto snapshot = TakeEnumerationSnapshot();
+    if (options->List)
+    {
+        PrintEnumerationSnapshot(snapshot);
+        return 0;
+    }
+    if (options->AllMonitors)
+    {
+        std::vector<CaptureSubject> monitorSubjects;
+        for (auto&& monitor : snapshot.Monitors)
+        {
+            monitorSubjects.push_back(CaptureSubject(MonitorCaptureSubject{ monitor.Index }));
+        }
+        options->Subjects.insert(options->Subjects.begin(), monitorSubjects.begin(), monitorSubjects.end());
+    }
+    // Prompting would stall unattended runs
+    bool interactive = !options->Run.DurationInSeconds.has_value() && !options->Matrix.has_value() && !options->AbTest.has_value() && !options->StartupIterations.has_value() && !options->Ramp.has_value();
+    std::unique_ptr<ContentGenerator> contentGenerator;
+    if (options->Content.has_value())
+    {
+        auto const& contentOptions = options->Content.value();
+        contentGenerator = std::make_unique<ContentGenerator>(contentOptions);
+        wprintf(L"Generating %dx%d content at %u fps\n", contentOptions.Size.Width, contentOptions.Size.Height, contentOptions.FramesPerSecond);
+    }
+    std::vector<CaptureItemSource> sources;
+    for (auto&& subject : options->Subjects)
+    {
+        auto sourceOpt = CreateItemSourceFromSubject(snapshot, subject, interactive);
+        if (!sourceOpt.has_value())
+        {
+            return 1;
+        }
+        sources.push_back(sourceOpt.value());
+    }
+    if (contentGenerator != nullptr)
+    {
+        // Carries the present times so each frame's counter can be matched
+        sources.push_back(CaptureItemSource(WindowCaptureItemSource{ contentGenerator->Window(), contentGenerator->Presents() }));
+    }
+
+    if (options->StartupIterations.has_value())
+    {
+        if (sources.size() > 1)
+        {
+            wprintf(L"Only the first subject is used to measure startup.\n");
+        }
+        RunStartupBenchmarks(sources.front(), options->Config, options->StartupIterations.value());
+        return 0;
+    }
+
+    // Before the sinks, which could be writing to the same file
+    std::vector<FrameRecord> baselineRecords;
+    if (options->Baseline.has_value())
+    {
+        auto const& path = options->Baseline->Path;
+        auto recordsOpt = LoadFrameRecords(path);
+        if (!recordsOpt.has_value() || recordsOpt->empty())
+        {
+            wprintf(L"Couldn't read any frames from the baseline \"%s\"!\n", path.c_str());
+            return 1;
+        }
+        baselineRecords = std::move(recordsOpt.value());
+        wprintf(L"Loaded %zu baseline frames from \"%s\"\n", baselineRecords.size(), path.c_str());
+    }
+
+    auto sinksOpt = CreateResultsSinks(options.value());
+    if (!sinksOpt.has_value())
     {
         return 1;
     }
-    auto source = sourceOpt.value();
-    bool noBorder = options->NoBorder;
-
-    // Init D3D
-    auto d3dDevice = util::CreateD3DDevice();
-    auto dxgiDevice = d3dDevice.as<IDXGIDevice>();
-    auto device = CreateDirect3DDevice(dxgiDevice.get());
-
-    // Create our capture thread
-    auto controller = winrt::DispatcherQueueController::CreateOnDedicatedThread();
-    auto queue = controller.DispatcherQueue();
-
-    // Setup capture and timer
-    winrt::Direct3D11CaptureFrame frame{ nullptr };
-    winrt::Direct3D11CaptureFramePool framePool{ nullptr };
-    winrt::GraphicsCaptureSession session{ nullptr };
-    winrt::DispatcherQueueTimer timer{ nullptr };
-    wil::shared_event captureThreadEvent(wil::EventOptions::None);
-    queue.TryEnqueue([captureThreadEvent, &framePool, &session, &frame, &timer, device, source, interval, queue, noBorder]()
-        {
-            auto item = CreateCaptureItemFromSource(source);
-            framePool = winrt::Direct3D11CaptureFramePool::Create(
-                device,
-                winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized,
-                1,
-                item.Size());
-            session = framePool.CreateCaptureSession(item);
-            framePool.FrameArrived([&frame](auto&& sender, auto&&)
-                {
-                    frame = sender.TryGetNextFrame();
-                });
-            session.IsCursorCaptureEnabled(false);
-            if (noBorder)
-            {
-                session.IsBorderRequired(false);
-            }
+    auto sinks = sinksOpt.value();
+    std::shared_ptr<MemorySink> currentRecords;
+    if (options->Baseline.has_value())
+    {
+        currentRecords = std::make_shared<MemorySink>();
+        sinks.push_back(currentRecords);
+    }
 
-            timer = queue.CreateTimer();
-            timer.Interval(std::chrono::milliseconds(interval));
-            timer.IsRepeating(true);
+    if (options->Soak.has_value())
+    {
+        auto growing = RunSoakTest(sources, options->Config, options->Soak.value(), sinks);
+        return growing ? ResourceGrowthExitCode : 0;
+    }
 
-            timer.Tick([&frame](auto&&, auto&&)
-                {
-                    if (frame != nullptr)
-                    {
-                        frame.Close();
-                    }
-                });
-            timer.Start();
+    if (options->Ramp.has_value())
+    {
+        RunRampTest(sources, options->Config, options->Ramp.value(), sinks);
+        return 0;
+    }
 
-            session.StartCapture();
-            captureThreadEvent.SetEvent();
-        });
-    captureThreadEvent.wait();
+    if (options->AbTest.has_value())
+    {
+        RunAbComparison(sources, options->AbTest.value(), options->Run, sinks);
+        return 0;
+    }
+
+    std::vector<LabeledCaptureSummary> results;
+    if (options->Matrix.has_value())
+    {
+        results = RunMatrix(sources, options->Matrix.value(), options->Run, sinks);
+    }
+    else
+    {
+        // Init D3D
+        auto device = CreateCaptureDevice(options->Config);
+        auto summary = RunBenchmark(device, sources, options->Config, options->Run, sinks);
+        PrintMultiCaptureSummary(summary);
+        results = summary.Sessions;
+    }
+
+    if (contentGenerator != nullptr)
+    {
+        wprintf(L"Content generator presented %I64u frames, missed %I64u ticks.\n", contentGenerator->FramesPresented(), contentGenerator->MissedTicks());
+        auto error = contentGenerator->Error();
+        if (error != S_OK)
+        {
+            wprintf(L"Content generator stopped presenting early: %s\n", winrt::hresult_error(error).message().c_str());
+        }
+    }
+
+    auto regressed = false;
+    if (currentRecords != nullptr)
+    {
+        auto const& comparison = options->Baseline->Comparison;
+        wprintf(L"Bootstrapping against the baseline...\n");
+        auto comparisons = CompareToBaseline(baselineRecords, currentRecords->Records(), comparison);
+        regressed = PrintBaselineReport(comparisons, comparison);
+    }
+
+    if (!MeetsMinimumFramesPerSecond(results, options->Run))
+    {
+        return BelowMinimumFramesPerSecondExitCode;
+    }
+    return regressed ? RegressionExitCode : 0;
+}
+
+void RunStartupBenchmarks(CaptureItemSource const& source, CaptureConfig const& config, uint32_t iterations)
+{
+    auto createDevice = [config]() { return CreateCaptureDevice(config); };
+
+    wprintf(L"Measuring startup with a new device per session...\n");
+    auto cold = RunStartupBenchmark(source, config, iterations, true, createDevice);
+    wprintf(L"Measuring startup with a shared device...\n");
+    auto warm = RunStartupBenchmark(source, config, iterations, false, createDevice);
 
-    // Wait
-    wprintf(L"Press ENTER to stop...\n");
-    std::wstring tempString;
-    std::getline(std::wcin, tempString);
+    wprintf(L"\n");
+    PrintStartupSummary(L"cold device", cold);
+    wprintf(L"\n");
+    PrintStartupSummary(L"warm device", warm);
+}
+
+bool RunSoakTest(std::vector<CaptureItemSource> const& sources, CaptureConfig const& config, SoakOptions const& soakOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks)
+{
+    // The device lives for the whole soak, only the sessions get recycled
+    auto device = CreateCaptureDevice(config);
+    winrt::com_ptr<IDXGIAdapter> adapter;
+    winrt::check_hresult(util::GetDXGIInterfaceFromObject<IDXGIDevice>(device)->GetAdapter(adapter.put()));
+    auto adapter3 = adapter.as<IDXGIAdapter3>();
 
-    captureThreadEvent.ResetEvent();
-    queue.TryEnqueue([timer, framePool, session, captureThreadEvent]()
+    auto createRunners = [&](uint32_t generation)
+    {
+        std::vector<std::unique_ptr<CaptureRunner>> runners;
+        for (auto&& source : sources)
         {
-            timer.Stop();
-            framePool.Close();
-            session.Close();
-            captureThreadEvent.SetEvent();
-        });
-    captureThreadEvent.wait();
-    wprintf(L"Shutting down capture thread...\n");
-    controller.ShutdownQueueAsync().get();
+            auto sessionConfig = config;
+            sessionConfig.RunId = generation;
+            sessionConfig.SessionIndex = static_cast<uint32_t>(runners.size());
+            runners.push_back(std::make_unique<CaptureRunner>(device, source, sessionConfig, sinks));
+        }
+        return runners;
+    };
+
+    wprintf(L"Sampling every %u seconds", soakOptions.SampleIntervalInSeconds);
+    if (soakOptions.RecycleIntervalInMinutes.has_value())
+    {
+        wprintf(L", recycling sessions every %u minutes", soakOptions.RecycleIntervalInMinutes.value());
+    }
+    wprintf(L"...\n");
+    auto samples = RunSoak(createRunners, adapter3, soakOptions);
+    return PrintSoakReport(samples);
+}
 
-    return 0;
+void RunRampTest(std::vector<CaptureItemSource> const& sources, CaptureConfig const& config, RampOptions const& rampOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks)
+{
+    auto device = CreateCaptureDevice(config);
+    std::vector<RampResult> results;
+    // One subject at a time so they don't compete for the DWM
+    for (auto&& source : sources)
+    {
+        auto sessionConfig = config;
+        sessionConfig.IntervalInMs = rampOptions.StartIntervalInMs;
+        sessionConfig.RunId = static_cast<uint32_t>(results.size());
+        CaptureRunner runner(device, source, sessionConfig, sinks);
+        runner.Start();
+        wprintf(L"Ramping %s from %u ms, %u seconds per step...\n", runner.DisplayName().c_str(), rampOptions.StartIntervalInMs, rampOptions.StepInSeconds);
+        results.push_back(RunRamp(runner, rampOptions));
+        runner.Stop();
+    }
+    PrintRampReport(results);
 }
 
-winrt::GraphicsCaptureItem CreateCaptureItemFromSource(CaptureItemSource itemSource)
+MultiCaptureSummary RunBenchmark(winrt::IDirect3DDevice const& device, std::vector<CaptureItemSource> const& sources, CaptureConfig const& config, RunOptions const& runOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks)
 {
-    return std::visit(overloaded
+    // Shared with the input thread, which can outlive this call
+    auto benchmark = std::make_shared<CaptureBenchmark>();
+    benchmark->Configure(sources, config, runOptions, sinks, device);
+
+    if (runOptions.WarmupInSeconds > 0)
+    {
+        wprintf(L"Warming up for %u seconds...\n", runOptions.WarmupInSeconds);
+    }
+    std::thread inputThread;
+    if (!runOptions.DurationInSeconds.has_value())
+    {
+        wprintf(L"Press ENTER to stop...\n");
+        inputThread = std::thread([benchmark]()
+            {
+                std::wstring tempString;
+                std::getline(std::wcin, tempString);
+                benchmark->Stop();
+            });
+    }
+    try
+    {
+        benchmark->Run();
+    }
+    catch (...)
+    {
+        // The reader is still blocked on the console, leave it behind like
+        // RunSoak does so the error reaches the caller
+        if (inputThread.joinable())
         {
-            [=](MonitorCaptureItemSource const& source) -> winrt::GraphicsCaptureItem { return util::CreateCaptureItemForMonitor(source.Monitor); },
-            [=](WindowCaptureItemSource const& source) -> winrt::GraphicsCaptureItem { return util::CreateCaptureItemForWindow(source.Window); },
-        }, itemSource);
+            inputThread.detach();
+        }
+        throw;
+    }
+    if (inputThread.joinable())
+    {
+        inputThread.join();
+    }
+    return benchmark->Results();
 }
 
-std::optional<CaptureItemSource> CreateItemSourceFromSubject(CaptureSubject captureSubject)
+bool MeetsMinimumFramesPerSecond(std::vector<LabeledCaptureSummary> const& summaries, RunOptions const& runOptions)
 {
-    return std::visit(overloaded
+    if (!runOptions.MinimumFramesPerSecond.has_value())
+    {
+        return true;
+    }
+
+    auto minimum = runOptions.MinimumFramesPerSecond.value();
+    bool passed = true;
+    for (auto const& labeled : summaries)
+    {
+        if (labeled.Summary.FramesPerSecond < minimum)
         {
-            [=](MonitorCaptureSubject const& subject) -> std::optional<CaptureItemSource> { return CreateCaptureSourceFromMonitorIndex(subject.MonitorIndex); },
-            [=](WindowCaptureSubject const& subject) -> std::optional<CaptureItemSource> { return CreateCaptureSourceFromWindowTitleSearch(subject.TitleQuery); },
-        }, captureSubject);
+            wprintf(L"FAILED: %s captured %.2f fps, below the minimum of %.2f fps.\n", labeled.Label.c_str(), labeled.Summary.FramesPerSecond, minimum);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+std::optional<std::vector<std::shared_ptr<ResultsSink>>> CreateResultsSinks(Options const& options)
+{
+    std::vector<std::shared_ptr<ResultsSink>> sinks;
+    if (!options.OutputPath.empty())
+    {
+        auto sink = CreateFileSinkFromPath(options.OutputPath);
+        if (sink == nullptr)
+        {
+            wprintf(L"Unknown output format for \"%s\", use .csv or .jsonl!\n", options.OutputPath.c_str());
+            return std::nullopt;
+        }
+        sinks.push_back(sink);
+    }
+    if (options.Etw)
+    {
+        sinks.push_back(std::make_shared<TraceLoggingSink>());
+    }
+    if (!options.LiveStatsName.empty())
+    {
+        try
+        {
+            sinks.push_back(std::make_shared<SharedMemorySink>(options.LiveStatsName));
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            wprintf(L"Couldn't publish live stats as \"%s\": %s\n", options.LiveStatsName.c_str(), error.message().c_str());
+            return std::nullopt;
+        }
+        wprintf(L"Publishing live stats as \"%s\"\n", options.LiveStatsName.c_str());
+    }
+    return std::optional(sinks);
+}
+
+bool WatchLiveStats(std::wstring const& name)
+{
+    auto reader = LiveStatsReader::Open(name);
+    if (reader == nullptr)
+    {
+        wprintf(L"Nothing is publishing live stats as \"%s\"!\n", name.c_str());
+        return false;
+    }
+    wprintf(L"Watching \"%s\" until it closes...\n", name.c_str());
+    while (!reader->Closed())
+    {
+        auto nowQpc = GetQpcNow();
+        wprintf(L"\n%-5s %-7s %-8s %-10s %-10s %-8s %-6s %s\n", L"Run", L"Session", L"FPS", L"Hold (ms)", L"Max (ms)", L"Dropped", L"Queue", L"Age (s)");
+        for (auto&& stats : reader->Read())
+        {
+            wprintf(L"%-5u %-7u %-8.2f %-10.3f %-10.3f %-8llu %-6d %.1f\n",
+                stats.RunId,
+                stats.SessionIndex,
+                stats.FramesPerSecond,
+                stats.MeanHoldTimeInMicroseconds / 1000.0,
+                static_cast<double>(stats.MaxHoldTimeInMicroseconds) / 1000.0,
+                stats.FramesDropped,
+                stats.QueueDepth,
+                QpcToSeconds(nowQpc - stats.UpdateQpc));
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    wprintf(L"The publisher closed \"%s\".\n", name.c_str());
+    return true;
+}
+
+std::vector<LabeledCaptureSummary> RunMatrix(std::vector<CaptureItemSource> const& sources, MatrixOptions const& matrix, RunOptions const& runOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks)
+{
+    auto totalRuns = static_cast<uint32_t>(matrix.Configs.size());
+    wprintf(L"Running %u configurations, %u seconds each...\n", totalRuns, matrix.DurationInSeconds);
+
+    std::vector<LabeledCaptureSummary> results;
+    for (auto const& labeledConfig : matrix.Configs)
+    {
+        auto config = labeledConfig.Config;
+        config.RunId = static_cast<uint32_t>(results.size());
+        wprintf(L"  [%zu/%u] %s\n", results.size() + 1, totalRuns, labeledConfig.Label.c_str());
+
+        auto configRunOptions = runOptions;
+        configRunOptions.DurationInSeconds = matrix.DurationInSeconds;
+        // Configurations can pick different adapters
+        auto device = CreateCaptureDevice(config);
+        auto summary = RunBenchmark(device, sources, config, configRunOptions, sinks);
+        // With several subjects each row is every session combined
+        results.push_back({ labeledConfig.Label, sources.size() > 1 ? summary.Aggregate : summary.Sessions.front().Summary });
+    }
+
+    wprintf(L"\n");
+    PrintCaptureSummaryTable(results);
+    return results;
+}
+
+void RunAbComparison(std::vector<CaptureItemSource> const& sources, AbTestPlan const& plan, RunOptions const& runOptions, std::vector<std::shared_ptr<ResultsSink>> const& sinks)
+{
+    auto const& test = plan.Test;
+    wprintf(L"Alternating %zu configurations in %u second windows, %u rounds...\n", plan.Configs.size(), test.WindowInSeconds, test.Rounds);
+
+    // None of the compared settings change the device
+    auto device = CreateCaptureDevice(plan.Configs.front().Config);
+    std::vector<std::wstring> labels;
+    for (auto&& labeledConfig : plan.Configs)
+    {
+        labels.push_back(labeledConfig.Label);
+    }
+    uint32_t windowIndex = 0;
+    auto samples = RunAbTest(labels, test, [&](size_t configIndex)
+        {
+            auto config = plan.Configs[configIndex].Config;
+            config.RunId = windowIndex++;
+            auto windowRunOptions = runOptions;
+            windowRunOptions.DurationInSeconds = test.WindowInSeconds;
+            auto summary = RunBenchmark(device, sources, config, windowRunOptions, sinks);
+            return sources.size() > 1 ? summary.Aggregate : summary.Sessions.front().Summary;
+        });
+    PrintAbReport(samples);
 }
 
-std::optional<CaptureItemSource> CreateCaptureSourceFromMonitorIndex(uint32_t monitorIndex)
+std::optional<CaptureItemSource> CreateItemSourceFromSubject(EnumerationSnapshot const& snapshot, CaptureSubject captureSubject, bool interactive)
 {
-    std::vector<HMONITOR> monitors;
-    winrt::check_bool(EnumDisplayMonitors(nullptr, nullptr, [](HMONITOR hmon, HDC, LPRECT, LPARAM lparam)
+    return std::visit(overloaded
         {
-            auto& monitors = *reinterpret_cast<std::vector<HMONITOR>*>(lparam);
-            monitors.push_back(hmon);
+            [&](MonitorCaptureSubject const& subject) -> std::optional<CaptureItemSource> { return CreateCaptureSourceFromMonitorIndex(snapshot, subject.MonitorIndex); },
+            [&](WindowCaptureSubject const& subject) -> std::optional<CaptureItemSource> { return CreateCaptureSourceFromWindowSearch(snapshot, subject, interactive); },
+            [=](WindowHandleCaptureSubject const& subject) -> std::optional<CaptureItemSource> { return CreateCaptureSourceFromWindowHandle(subject.Window); },
+        }, captureSubject);
+}
 
-            return TRUE;
-        }, reinterpret_cast<LPARAM>(&monitors)));
+std::optional<CaptureItemSource> CreateCaptureSourceFromMonitorIndex(EnumerationSnapshot const& snapshot, uint32_t monitorIndex)
+{
+    auto const& monitors = snapshot.Monitors;
 
     if (monitorIndex < monitors.size())
     {
-        return std::optional(CaptureItemSource(MonitorCaptureItemSource{ monitors[monitorIndex] }));
+        return std::optional(CaptureItemSource(MonitorCaptureItemSource{ monitors[monitorIndex].Monitor }));
     }
     else
     {
@@ -193,25 +561,36 @@ std::optional<CaptureItemSource> CreateCaptureSourceFromMonitorIndex(uint32_t mo
     }
 }
 
-std::optional<CaptureItemSource> CreateCaptureSourceFromWindowTitleSearch(std::wstring const& titleQuery)
+std::optional<CaptureItemSource> CreateCaptureSourceFromWindowSearch(EnumerationSnapshot const& snapshot, WindowCaptureSubject const& subject, bool interactive)
 {
-    auto windows = util::FindTopLevelWindowsByTitle(titleQuery);
+    auto windows = FindWindowsInSnapshot(snapshot, subject.TitleQuery, subject.ProcessId);
     if (windows.size() == 0)
     {
         wprintf(L"No windows found!\n");
         return std::nullopt;
     }
 
-    auto foundWindow = GetWindowToCapture(windows);
+    auto foundWindow = GetWindowToCapture(windows, subject.WindowIndex, interactive);
     if (!foundWindow.has_value())
     {
         return std::nullopt;
     }
     wprintf(L"Using window \"%s\"\n", foundWindow->Title.c_str());
-    return std::optional(CaptureItemSource(WindowCaptureItemSource{ foundWindow->WindowHandle }));
+    return std::optional(CaptureItemSource(WindowCaptureItemSource{ foundWindow->Window }));
+}
+
+std::optional<CaptureItemSource> CreateCaptureSourceFromWindowHandle(HWND window)
+{
+    if (!IsWindow(window))
+    {
+        wprintf(L"Invalid window handle specified!\n");
+        return std::nullopt;
+    }
+    wprintf(L"Using window 0x%p\n", window);
+    return std::optional(CaptureItemSource(WindowCaptureItemSource{ window }));
 }
 
-std::optional<util::WindowInfo> GetWindowToCapture(std::vector<util::WindowInfo> const& windows)
+std::optional<WindowEntry> GetWindowToCapture(std::vector<WindowEntry> const& windows, std::optional<uint32_t> windowIndex, bool interactive)
 {
     if (windows.empty())
     {
@@ -220,19 +599,32 @@ std::optional<util::WindowInfo> GetWindowToCapture(std::vector<util::WindowInfo>
 
     auto numWindowsFound = windows.size();
     auto foundWindow = windows[0];
-    if (numWindowsFound > 1)
+    if (windowIndex.has_value())
+    {
+        if (windowIndex.value() >= numWindowsFound)
+        {
+            wprintf(L"Window index %u is out of bounds, found %I64u windows!\n", windowIndex.value(), numWindowsFound);
+            return std::nullopt;
+        }
+        foundWindow = windows[windowIndex.value()];
+    }
+    else if (numWindowsFound > 1)
     {
         wprintf(L"Found %I64u windows that match:\n", numWindowsFound);
-        wprintf(L"    Num    PID       Window Title\n");
+        wprintf(L"    Num    PID       Process                  Window Title\n");
         auto count = 0;
         for (auto const& window : windows)
         {
-            DWORD pid = 0;
-            auto ignored = GetWindowThreadProcessId(window.WindowHandle, &pid);
-            wprintf(L"    %3i    %06u    %s\n", count, pid, window.Title.c_str());
+            wprintf(L"    %3i    %06u    %-24s %s\n", count, window.ProcessId, window.ProcessName.c_str(), window.Title.c_str());
             count++;
         }
 
+        if (!interactive)
+        {
+            wprintf(L"Use 'windowIndex' or 'pid' to pick a window when running unattended.\n");
+            return std::nullopt;
+        }
+
         do
         {
             wprintf(L"Please make a selection (q to quit): ");
@@ -272,6 +664,102 @@ std::optional<uint32_t> ParseNumberString(std::wstring const& numberString)
     return std::nullopt;
 }
 
+std::optional<double> ParseDoubleString(std::wstring const& numberString)
+{
+    try
+    {
+        return std::optional(std::stod(numberString));
+    }
+    catch (...)
+    {
+    }
+    return std::nullopt;
+}
+
+std::optional<HWND> ParseWindowHandleString(std::wstring const& handleString)
+{
+    try
+    {
+        // Base 0 accepts both hex (0x...) and decimal
+        auto value = std::stoull(handleString, nullptr, 0);
+        return std::optional(reinterpret_cast<HWND>(static_cast<uintptr_t>(value)));
+    }
+    catch (...)
+    {
+    }
+    return std::nullopt;
+}
+
+// e.g. 1920x1080
+std::optional<winrt::Windows::Graphics::SizeInt32> ParseSizeString(std::wstring const& sizeString)
+{
+    auto separator = sizeString.find_first_of(L"xX");
+    if (separator == std::wstring::npos)
+    {
+        return std::nullopt;
+    }
+    auto width = ParseNumberString(sizeString.substr(0, separator));
+    auto height = ParseNumberString(sizeString.substr(separator + 1));
+    if (!width.has_value() || !height.has_value() || width.value() == 0 || height.value() == 0)
+    {
+        return std::nullopt;
+    }
+    return std::optional(winrt::Windows::Graphics::SizeInt32{ static_cast<int32_t>(width.value()), static_cast<int32_t>(height.value()) });
+}
+
+std::optional<std::vector<uint32_t>> ParseNumberListString(std::wstring const& listString)
+{
+    std::vector<uint32_t> numbers;
+    std::wstringstream stream(listString);
+    std::wstring numberString;
+    while (std::getline(stream, numberString, L','))
+    {
+        auto number = ParseNumberString(numberString);
+        if (!number.has_value())
+        {
+            return std::nullopt;
+        }
+        numbers.push_back(number.value());
+    }
+    if (numbers.empty())
+    {
+        return std::nullopt;
+    }
+    return std::optional(numbers);
+}
+
+// GetFlagValue only returns the first occurrence
+std::vector<std::wstring> GetFlagValues(std::vector<std::wstring> const& args, std::wstring const& flag, std::wstring const& alias)
+{
+    std::vector<std::wstring> values;
+    for (size_t i = 0; i + 1 < args.size(); i++)
+    {
+        if (_wcsicmp(args[i].c_str(), flag.c_str()) == 0 || _wcsicmp(args[i].c_str(), alias.c_str()) == 0)
+        {
+            values.push_back(args[i + 1]);
+            i++;
+        }
+    }
+    return values;
+}
+
+// Produces the cross product of the existing configurations and the variants
+std::vector<LabeledCaptureConfig> ExpandConfigs(std::vector<LabeledCaptureConfig> const& configs, std::vector<ConfigVariant> const& variants)
+{
+    std::vector<LabeledCaptureConfig> expanded;
+    for (auto const& labeledConfig : configs)
+    {
+        for (auto const& variant : variants)
+        {
+            auto config = labeledConfig.Config;
+            variant.Apply(config);
+            auto label = labeledConfig.Label.empty() ? variant.Label : labeledConfig.Label + L" / " + variant.Label;
+            expanded.push_back({ label, config });
+        }
+    }
+    return expanded;
+}
+
 std::optional<Options> ParseOptions(int argc, wchar_t* argv[], bool& error)
 {
     error = true;
@@ -283,72 +771,819 @@ std::optional<Options> ParseOptions(int argc, wchar_t* argv[], bool& error)
         wprintf(L"\n");
         wprintf(L"Options:\n");
         wprintf(L"  -interval [value] (optional) Specify the capture interval in ms. Default is 1000.\n");
+        wprintf(L"                                 With 'sweep', a comma separated list of intervals.\n");
+        wprintf(L"  -buffers  [value] (optional) Specify the number of frame pool buffers. Default is 1.\n");
+        wprintf(L"                                 With 'sweep', the largest buffer count to test.\n");
+        wprintf(L"  -sweepDuration [value] (optional) Seconds to run each configuration when comparing\n");
+        wprintf(L"                                 ('sweep', 'compare*'). Default is 10.\n");
+        wprintf(L"  -output   [value] (optional) Stream per-frame records to a .csv or .jsonl file.\n");
+        wprintf(L"  -scheduler [value] (optional) How held frames are released. Default is 'dispatcher'.\n");
+        wprintf(L"                                 dispatcher - DispatcherQueueTimer, ~15.6ms granularity\n");
+        wprintf(L"                                 hrtimer    - high resolution waitable timer thread\n");
+        wprintf(L"                                 vblank     - first vblank after each interval\n");
+        wprintf(L"  -format   [value] (optional) The frame pool pixel format, 'bgra8' or 'fp16'. Default is 'bgra8'.\n");
+        wprintf(L"                                 fp16 is R16G16B16A16Float, used for HDR content.\n");
+        wprintf(L"  -adapter  [value] (optional) The adapter to create the capture device on, by index or by\n");
+        wprintf(L"                                 LUID (0x...). Default is the system default adapter.\n");
+        wprintf(L"  -workload [value] (optional) Work done on each frame before it is held. Default is 'none'.\n");
+        wprintf(L"                                 copy     - CopyResource to another texture\n");
+        wprintf(L"                                 readback - copy to a staging texture, read it a few frames later\n");
+        wprintf(L"                                 compute  - a compute shader pass over the frame\n");
+        wprintf(L"                                 encode   - hardware H.264 encode to 'encodeOutput'\n");
+        wprintf(L"                                 pipeline - NV12 conversion into an asynchronous hardware\n");
+        wprintf(L"                                            encoder, reporting where it backs up\n");
+        wprintf(L"  -encodeOutput [value] (optional) The mp4 written by the 'encode' workload.\n");
+        wprintf(L"                                 Default is %%TEMP%%\\CaptureRateTest.mp4.\n");
+        wprintf(L"  -codec    [value] (optional) The 'pipeline' workload's codec, 'h264' or 'hevc'. Default is 'h264'.\n");
+        wprintf(L"  -pipelineDepth [value] (optional) NV12 surfaces the 'pipeline' workload can have in flight.\n");
+        wprintf(L"                                 Default is %u.\n", PipelineOptions{}.Depth);
+        wprintf(L"  -workers  [value] (optional) Hand frames to this many worker threads through a bounded queue\n");
+        wprintf(L"                                 instead of holding them. Each worker runs its own 'workload'\n");
+        wprintf(L"                                 and closes the frame when it's done. GPU work isn't timed\n");
+        wprintf(L"                                 with more than one worker.\n");
+        wprintf(L"  -queueDepth [value] (optional) Frames the 'workers' queue holds before dropping. Default is\n");
+        wprintf(L"                                 the buffer count.\n");
         wprintf(L"  -monitor  [value]            Specify the monitor to capture via index. Default is 0.\n");
-        wprintf(L"                                 Conflicts with 'window'.\n");
+        wprintf(L"                                 Can be repeated and combined with 'window' and 'hwnd' to\n");
+        wprintf(L"                                 capture several subjects at once, one session each.\n");
         wprintf(L"  -window   [value]            Specify the window to capture via title substring search.\n");
-        wprintf(L"                                 Conflicts with 'monitor'.\n");
+        wprintf(L"                                 Can be repeated.\n");
+        wprintf(L"  -windowIndex [value] (optional) Pick a window from multiple 'window' matches without prompting.\n");
+        wprintf(L"  -pid      [value] (optional) Only match windows owned by this process. Can be used without 'window'.\n");
+        wprintf(L"  -hwnd     [value]            Specify the window to capture via handle (hex or decimal).\n");
+        wprintf(L"                                 Can be repeated.\n");
+        wprintf(L"  -duration [value] (optional) Stop after this many seconds instead of waiting for ENTER.\n");
+        wprintf(L"  -warmup   [value] (optional) Seconds to capture before measuring. Default is 0.\n");
+        wprintf(L"  -startupIterations [value] (optional) Instead of measuring capture rate, start and stop this many\n");
+        wprintf(L"                                 sessions and report how long each startup step takes, with a new\n");
+        wprintf(L"                                 device per session and with a shared one.\n");
+        wprintf(L"  -sampleInterval [value] (optional) Seconds between 'soak' samples. Default is 60.\n");
+        wprintf(L"  -recycle  [value] (optional) With 'soak', recreate the sessions every this many minutes.\n");
+        wprintf(L"  -contentFps [value] (optional) The rate 'generateContent' presents at. Default is 60.\n");
+        wprintf(L"  -contentSize [value] (optional) The size of the 'generateContent' window, e.g. 1920x1080.\n");
+        wprintf(L"                                 Default is 1280x720.\n");
+        wprintf(L"  -rampStep [value] (optional) Seconds measured at each 'ramp' interval. Default is %u.\n", RampOptions{}.StepInSeconds);
+        wprintf(L"  -abWindow [value] (optional) Seconds per configuration per round in an A/B test. Default is 10.\n");
+        wprintf(L"  -abRounds [value] (optional) Rounds in an A/B test. Default is 5.\n");
+        wprintf(L"  -minFps   [value] (optional) Exit with code %d if a run captures fewer frames per second.\n", BelowMinimumFramesPerSecondExitCode);
+        wprintf(L"  -baseline [value] (optional) A .csv or .jsonl written by a previous run's 'output'. Prints how fps\n");
+        wprintf(L"                                 and latency changed with bootstrapped intervals, and exits with\n");
+        wprintf(L"                                 code %d if fps or p99 latency got worse by more than 'threshold'.\n", RegressionExitCode);
+        wprintf(L"                                 Use the same 'warmup' as the baseline, warmup frames are kept.\n");
+        wprintf(L"  -threshold [value] (optional) Percent a 'baseline' metric can get worse by. Default is 5.\n");
         wprintf(L"\n");
         wprintf(L"Flags:\n");
         wprintf(L"  -noBorder         (optional) Disable the yellow border. Only available on Windows 11.\n");
+        wprintf(L"  -cursor           (optional) Capture the cursor.\n");
+        wprintf(L"  -dirtyRegions     (optional) Report dirty rects per frame and how much copy bandwidth they'd save.\n");
+        wprintf(L"                                 Only available on recent builds of Windows 11.\n");
+        wprintf(L"  -noRecreate       (optional) Keep the frame pool at its initial size when the content is resized.\n");
+        wprintf(L"  -allMonitors      (optional) Capture every monitor, one session each.\n");
+        wprintf(L"  -freeThreaded     (optional) Create the frame pool with CreateFreeThreaded, FrameArrived is\n");
+        wprintf(L"                                 raised on a thread pool thread instead of the dispatcher queue.\n");
+        wprintf(L"  -compareThreading (optional) Run the dispatcher and free-threaded frame pools back to back\n");
+        wprintf(L"                                 and print them side by side.\n");
+        wprintf(L"  -minUpdateInterval (optional) Throttle with GraphicsCaptureSession.MinUpdateInterval set to\n");
+        wprintf(L"                                 'interval' and close frames immediately instead of holding them.\n");
+        wprintf(L"  -compareAdapters  (optional) Run on every hardware adapter back to back and print them side by\n");
+        wprintf(L"                                 side, capturing from another adapter than the monitor's is flagged.\n");
+        wprintf(L"  -compareFormats   (optional) Run the bgra8 and fp16 pixel formats back to back and print them\n");
+        wprintf(L"                                 side by side.\n");
+        wprintf(L"  -compareThrottling (optional) Run buffer starvation and MinUpdateInterval back to back and\n");
+        wprintf(L"                                 print them side by side.\n");
+        wprintf(L"  -abCursor         (optional) A/B test cursor capture off against on, alternating 'abWindow'\n");
+        wprintf(L"                                 second windows and comparing fps and latency with a t-test.\n");
+        wprintf(L"  -abBorder         (optional) A/B test the border on against off. Combined with 'abCursor',\n");
+        wprintf(L"                                 every combination is compared against cursor off, border on.\n");
+        wprintf(L"  -sweep            (optional) Run every combination of buffer count (1 to 'buffers') and\n");
+        wprintf(L"                                 'interval' for a fixed duration and print a comparison table.\n");
+        wprintf(L"  -soak             (optional) Capture until 'duration' or ENTER while sampling memory, GPU memory\n");
+        wprintf(L"                                 and handles, then report anything that grew steadily. Exits with\n");
+        wprintf(L"                                 code %d if something did.\n", ResourceGrowthExitCode);
+        wprintf(L"  -ramp             (optional) Start at 'interval' and keep shortening it, %u seconds per step,\n", RampOptions{}.StepInSeconds);
+        wprintf(L"                                 until fps stops keeping up with the release rate or refresh\n");
+        wprintf(L"                                 rate, or p99 latency spikes. Prints the shortest sustainable\n");
+        wprintf(L"                                 interval per subject. Needs content that changes every frame,\n");
+        wprintf(L"                                 like 'generateContent'.\n");
+        wprintf(L"  -generateContent  (optional) Capture a window presenting a frame counter at 'contentFps', so\n");
+        wprintf(L"                                 every run sees the same load. Used instead of monitor 0 when\n");
+        wprintf(L"                                 no other subject is given.\n");
+        wprintf(L"  -list             (optional) Print the monitors and capturable windows, with their process,\n");
+        wprintf(L"                                 size, refresh and signal rate, overlay (MPO) and tearing\n");
+        wprintf(L"                                 support, then exit.\n");
+        wprintf(L"  -etw              (optional) Emit per-frame records from the \"CaptureRateTest\" TraceLogging provider.\n");
+        wprintf(L"  -liveStats [name] (optional) Publish rolling fps, hold time, drops and queue depth per session\n");
+        wprintf(L"                                 to named shared memory, e.g. \"Local\\CaptureRateTest\". See LiveStats.h\n");
+        wprintf(L"                                 for the layout.\n");
+        wprintf(L"  -watch [name]     (optional) Print the live stats another instance publishes under 'name' once\n");
+        wprintf(L"                                 a second, until it exits. Nothing is captured.\n");
         wprintf(L"\n");
         error = false;
         return std::nullopt;
     }
     auto intervalString = robmikh::common::wcli::impl::GetFlagValue(args, L"-interval", L"-i");
-    auto monitorString = robmikh::common::wcli::impl::GetFlagValue(args, L"-monitor", L"-m");
-    auto windowString = robmikh::common::wcli::impl::GetFlagValue(args, L"-window", L"-w");
+    auto monitorStrings = GetFlagValues(args, L"-monitor", L"-m");
+    auto windowStrings = GetFlagValues(args, L"-window", L"-w");
+    auto hwndStrings = GetFlagValues(args, L"-hwnd", L"-hwnd");
+    auto buffersString = robmikh::common::wcli::impl::GetFlagValue(args, L"-buffers", L"-b");
+    auto sweepDurationString = robmikh::common::wcli::impl::GetFlagValue(args, L"-sweepDuration");
+    auto outputPath = robmikh::common::wcli::impl::GetFlagValue(args, L"-output", L"-o");
+    auto liveStatsName = robmikh::common::wcli::impl::GetFlagValue(args, L"-liveStats");
+    auto watchName = robmikh::common::wcli::impl::GetFlagValue(args, L"-watch");
+    auto windowIndexString = robmikh::common::wcli::impl::GetFlagValue(args, L"-windowIndex");
+    auto pidString = robmikh::common::wcli::impl::GetFlagValue(args, L"-pid");
+    auto durationString = robmikh::common::wcli::impl::GetFlagValue(args, L"-duration", L"-d");
+    auto warmupString = robmikh::common::wcli::impl::GetFlagValue(args, L"-warmup");
+    auto minFpsString = robmikh::common::wcli::impl::GetFlagValue(args, L"-minFps");
+    auto startupIterationsString = robmikh::common::wcli::impl::GetFlagValue(args, L"-startupIterations");
+    auto sampleIntervalString = robmikh::common::wcli::impl::GetFlagValue(args, L"-sampleInterval");
+    auto recycleString = robmikh::common::wcli::impl::GetFlagValue(args, L"-recycle");
+    auto schedulerString = robmikh::common::wcli::impl::GetFlagValue(args, L"-scheduler");
+    auto formatString = robmikh::common::wcli::impl::GetFlagValue(args, L"-format");
+    auto adapterString = robmikh::common::wcli::impl::GetFlagValue(args, L"-adapter");
+    auto workloadString = robmikh::common::wcli::impl::GetFlagValue(args, L"-workload");
+    auto encodeOutputPath = robmikh::common::wcli::impl::GetFlagValue(args, L"-encodeOutput");
+    auto codecString = robmikh::common::wcli::impl::GetFlagValue(args, L"-codec");
+    auto pipelineDepthString = robmikh::common::wcli::impl::GetFlagValue(args, L"-pipelineDepth");
+    auto contentFpsString = robmikh::common::wcli::impl::GetFlagValue(args, L"-contentFps");
+    auto workersString = robmikh::common::wcli::impl::GetFlagValue(args, L"-workers");
+    auto queueDepthString = robmikh::common::wcli::impl::GetFlagValue(args, L"-queueDepth");
+    auto contentSizeString = robmikh::common::wcli::impl::GetFlagValue(args, L"-contentSize");
+    auto abWindowString = robmikh::common::wcli::impl::GetFlagValue(args, L"-abWindow");
+    auto abRoundsString = robmikh::common::wcli::impl::GetFlagValue(args, L"-abRounds");
+    auto rampStepString = robmikh::common::wcli::impl::GetFlagValue(args, L"-rampStep");
+    auto baselinePath = robmikh::common::wcli::impl::GetFlagValue(args, L"-baseline");
+    auto thresholdString = robmikh::common::wcli::impl::GetFlagValue(args, L"-threshold");
     bool noBorder = robmikh::common::wcli::impl::GetFlag(args, L"-noBorder") || robmikh::common::wcli::impl::GetFlag(args, L"/noBorder");
+    bool cursor = robmikh::common::wcli::impl::GetFlag(args, L"-cursor") || robmikh::common::wcli::impl::GetFlag(args, L"/cursor");
+    bool abCursor = robmikh::common::wcli::impl::GetFlag(args, L"-abCursor") || robmikh::common::wcli::impl::GetFlag(args, L"/abCursor");
+    bool abBorder = robmikh::common::wcli::impl::GetFlag(args, L"-abBorder") || robmikh::common::wcli::impl::GetFlag(args, L"/abBorder");
+    bool dirtyRegions = robmikh::common::wcli::impl::GetFlag(args, L"-dirtyRegions") || robmikh::common::wcli::impl::GetFlag(args, L"/dirtyRegions");
+    bool noRecreate = robmikh::common::wcli::impl::GetFlag(args, L"-noRecreate") || robmikh::common::wcli::impl::GetFlag(args, L"/noRecreate");
+    bool sweep = robmikh::common::wcli::impl::GetFlag(args, L"-sweep") || robmikh::common::wcli::impl::GetFlag(args, L"/sweep");
+    bool etw = robmikh::common::wcli::impl::GetFlag(args, L"-etw") || robmikh::common::wcli::impl::GetFlag(args, L"/etw");
+    bool list = robmikh::common::wcli::impl::GetFlag(args, L"-list") || robmikh::common::wcli::impl::GetFlag(args, L"/list");
+    bool allMonitors = robmikh::common::wcli::impl::GetFlag(args, L"-allMonitors") || robmikh::common::wcli::impl::GetFlag(args, L"/allMonitors");
+    bool freeThreaded = robmikh::common::wcli::impl::GetFlag(args, L"-freeThreaded") || robmikh::common::wcli::impl::GetFlag(args, L"/freeThreaded");
+    bool compareThreading = robmikh::common::wcli::impl::GetFlag(args, L"-compareThreading") || robmikh::common::wcli::impl::GetFlag(args, L"/compareThreading");
+    bool minUpdateInterval = robmikh::common::wcli::impl::GetFlag(args, L"-minUpdateInterval") || robmikh::common::wcli::impl::GetFlag(args, L"/minUpdateInterval");
+    bool compareThrottling = robmikh::common::wcli::impl::GetFlag(args, L"-compareThrottling") || robmikh::common::wcli::impl::GetFlag(args, L"/compareThrottling");
+    bool compareFormats = robmikh::common::wcli::impl::GetFlag(args, L"-compareFormats") || robmikh::common::wcli::impl::GetFlag(args, L"/compareFormats");
+    bool compareAdapters = robmikh::common::wcli::impl::GetFlag(args, L"-compareAdapters") || robmikh::common::wcli::impl::GetFlag(args, L"/compareAdapters");
+    bool ramp = robmikh::common::wcli::impl::GetFlag(args, L"-ramp") || robmikh::common::wcli::impl::GetFlag(args, L"/ramp");
+    bool soak = robmikh::common::wcli::impl::GetFlag(args, L"-soak") || robmikh::common::wcli::impl::GetFlag(args, L"/soak");
+    bool generateContent = robmikh::common::wcli::impl::GetFlag(args, L"-generateContent") || robmikh::common::wcli::impl::GetFlag(args, L"/generateContent");
     
-    uint32_t interval = 1000;
+    std::vector<uint32_t> intervals = { 1000 };
+    if (sweep)
+    {
+        intervals = { 8, 16, 33, 100 };
+    }
     if (!intervalString.empty())
     {
-        if (auto parsedInterval = ParseNumberString(intervalString))
+        auto parsedIntervals = ParseNumberListString(intervalString);
+        if (!parsedIntervals.has_value())
         {
-            interval = parsedInterval.value();
+            wprintf(L"Invalid interval specified!\n");
+            return std::nullopt;
         }
-        else
+        if (!sweep && parsedIntervals->size() > 1)
         {
-            wprintf(L"Invalid interval specified!\n");
+            wprintf(L"Multiple intervals can only be used with 'sweep'!\n");
             return std::nullopt;
         }
+        intervals = parsedIntervals.value();
     }
 
-    if (!monitorString.empty() && !windowString.empty())
+    uint32_t bufferCount = 1;
+    if (sweep)
     {
-        wprintf(L"Cannot use options 'monitor' and 'window' at the same time!\n");
-        return std::nullopt;
+        bufferCount = 3;
     }
-
-    uint32_t monitorIndex = 0;
-    if (!monitorString.empty())
+    if (!buffersString.empty())
     {
-        if (auto parsedIndex = ParseNumberString(intervalString))
+        auto parsedBufferCount = ParseNumberString(buffersString);
+        if (parsedBufferCount.has_value() && parsedBufferCount.value() > 0)
         {
-            interval = parsedIndex.value();
+            bufferCount = parsedBufferCount.value();
         }
         else
         {
-            wprintf(L"Invalid monitor index specified!\n");
+            wprintf(L"Invalid buffer count specified!\n");
             return std::nullopt;
         }
     }
 
-    CaptureSubject subject;
-    if (!windowString.empty())
-    {
-        subject = CaptureSubject(WindowCaptureSubject{ windowString });
-    }
-    else
+    uint32_t sweepDuration = 10;
+    if (!sweepDurationString.empty())
     {
-        subject = CaptureSubject(MonitorCaptureSubject{ monitorIndex });
+        auto parsedDuration = ParseNumberString(sweepDurationString);
+        if (parsedDuration.has_value() && parsedDuration.value() > 0)
+        {
+            sweepDuration = parsedDuration.value();
+        }
+        else
+        {
+            wprintf(L"Invalid sweep duration specified!\n");
+            return std::nullopt;
+        }
     }
 
-    if (noBorder && !winrt::ApiInformation::IsPropertyPresent(winrt::name_of<winrt::GraphicsCaptureSession>(), L"IsBorderRequired"))
+    auto scheduler = ReleaseSchedulerKind::Dispatcher;
+    if (!schedulerString.empty())
     {
-        wprintf(L"Ignoring 'noBorder', this build of Windows does not support the feature.\n");
-        noBorder = false;
+        if (schedulerString == L"dispatcher")
+        {
+            scheduler = ReleaseSchedulerKind::Dispatcher;
+        }
+        else if (schedulerString == L"hrtimer")
+        {
+            scheduler = ReleaseSchedulerKind::HighResolution;
+        }
+        else if (schedulerString == L"vblank")
+        {
+            scheduler = ReleaseSchedulerKind::VBlank;
+        }
+        else
+        {
+            wprintf(L"Invalid scheduler specified!\n");
+            return std::nullopt;
+        }
+    }
+    // A zero interval would have the release thread spin
+    if (scheduler != ReleaseSchedulerKind::Dispatcher && std::find(intervals.begin(), intervals.end(), 0u) != intervals.end())
+    {
+        wprintf(L"The 'hrtimer' and 'vblank' schedulers need an interval of at least 1 ms!\n");
+        return std::nullopt;
+    }
+
+    auto pixelFormat = winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized;
+    if (!formatString.empty())
+    {
+        if (formatString == L"bgra8")
+        {
+            pixelFormat = winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized;
+        }
+        else if (formatString == L"fp16")
+        {
+            pixelFormat = winrt::DirectXPixelFormat::R16G16B16A16Float;
+        }
+        else
+        {
+            wprintf(L"Invalid format specified!\n");
+            return std::nullopt;
+        }
+    }
+
+    auto adapters = EnumerateAdapters();
+    std::optional<uint32_t> adapterIndex;
+    if (!adapterString.empty())
+    {
+        if (adapterString.rfind(L"0x", 0) == 0 || adapterString.rfind(L"0X", 0) == 0)
+        {
+            auto luid = ParseLuidString(adapterString.substr(2));
+            auto adapter = luid.has_value() ? FindAdapterByLuid(adapters, luid.value()) : std::nullopt;
+            if (adapter.has_value())
+            {
+                adapterIndex = adapter->Index;
+            }
+        }
+        else if (auto parsedIndex = ParseNumberString(adapterString))
+        {
+            if (parsedIndex.value() < adapters.size())
+            {
+                adapterIndex = parsedIndex;
+            }
+        }
+        if (!adapterIndex.has_value())
+        {
+            wprintf(L"Invalid adapter specified! Available adapters:\n");
+            for (auto&& adapter : adapters)
+            {
+                wprintf(L"  %u: %s (%s)\n", adapter.Index, adapter.Description.c_str(), FormatLuid(adapter.Luid).c_str());
+            }
+            return std::nullopt;
+        }
+    }
+
+    auto workload = WorkloadKind::None;
+    if (!workloadString.empty())
+    {
+        if (workloadString == L"none")
+        {
+            workload = WorkloadKind::None;
+        }
+        else if (workloadString == L"copy")
+        {
+            workload = WorkloadKind::Copy;
+        }
+        else if (workloadString == L"readback")
+        {
+            workload = WorkloadKind::Readback;
+        }
+        else if (workloadString == L"compute")
+        {
+            workload = WorkloadKind::Compute;
+        }
+        else if (workloadString == L"encode")
+        {
+            workload = WorkloadKind::Encode;
+        }
+        else if (workloadString == L"pipeline")
+        {
+            workload = WorkloadKind::Pipeline;
+        }
+        else
+        {
+            wprintf(L"Invalid workload specified!\n");
+            return std::nullopt;
+        }
+    }
+    // The encoders take 8-bit input
+    auto encodes = workload == WorkloadKind::Encode || workload == WorkloadKind::Pipeline;
+    if (encodes && (pixelFormat != winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized || compareFormats))
+    {
+        wprintf(L"The 'encode' and 'pipeline' workloads only support the 'bgra8' format!\n");
+        return std::nullopt;
+    }
+    PipelineOptions pipelineOptions = {};
+    if (!codecString.empty())
+    {
+        if (codecString == L"h264")
+        {
+            pipelineOptions.Codec = VideoCodec::H264;
+        }
+        else if (codecString == L"hevc")
+        {
+            pipelineOptions.Codec = VideoCodec::Hevc;
+        }
+        else
+        {
+            wprintf(L"Invalid codec specified!\n");
+            return std::nullopt;
+        }
+        if (workload != WorkloadKind::Pipeline)
+        {
+            wprintf(L"Ignoring 'codec', it is only used by the 'pipeline' workload.\n");
+        }
+    }
+    if (!pipelineDepthString.empty())
+    {
+        auto parsedDepth = ParseNumberString(pipelineDepthString);
+        if (!parsedDepth.has_value() || parsedDepth.value() == 0)
+        {
+            wprintf(L"Invalid pipeline depth specified!\n");
+            return std::nullopt;
+        }
+        if (workload != WorkloadKind::Pipeline)
+        {
+            wprintf(L"Ignoring 'pipelineDepth', it is only used by the 'pipeline' workload.\n");
+        }
+        pipelineOptions.Depth = parsedDepth.value();
+    }
+    if (!encodeOutputPath.empty() && workload != WorkloadKind::Encode)
+    {
+        wprintf(L"Ignoring 'encodeOutput', it is only used by the 'encode' workload.\n");
+    }
+    if (encodeOutputPath.empty())
+    {
+        std::array<wchar_t, MAX_PATH + 1> tempPath = {};
+        auto length = GetTempPathW(static_cast<DWORD>(tempPath.size()), tempPath.data());
+        encodeOutputPath = std::wstring(tempPath.data(), length) + L"CaptureRateTest.mp4";
+    }
+
+    uint32_t workerCount = 0;
+    if (!workersString.empty())
+    {
+        auto parsedWorkers = ParseNumberString(workersString);
+        if (parsedWorkers.has_value() && parsedWorkers.value() > 0)
+        {
+            workerCount = parsedWorkers.value();
+        }
+        else
+        {
+            wprintf(L"Invalid worker count specified!\n");
+            return std::nullopt;
+        }
+    }
+    uint32_t queueDepth = 0;
+    if (!queueDepthString.empty())
+    {
+        auto parsedDepth = ParseNumberString(queueDepthString);
+        if (!parsedDepth.has_value() || parsedDepth.value() == 0)
+        {
+            wprintf(L"Invalid queue depth specified!\n");
+            return std::nullopt;
+        }
+        if (workerCount == 0)
+        {
+            wprintf(L"Ignoring 'queueDepth', it is only used with 'workers'.\n");
+        }
+        queueDepth = parsedDepth.value();
+    }
+    if (workerCount > 0 && !schedulerString.empty())
+    {
+        wprintf(L"Ignoring 'scheduler', workers release frames themselves.\n");
+    }
+
+    RunOptions runOptions = {};
+    if (!durationString.empty())
+    {
+        auto parsedDuration = ParseNumberString(durationString);
+        if (parsedDuration.has_value() && parsedDuration.value() > 0)
+        {
+            runOptions.DurationInSeconds = parsedDuration;
+        }
+        else
+        {
+            wprintf(L"Invalid duration specified!\n");
+            return std::nullopt;
+        }
+    }
+    if (!warmupString.empty())
+    {
+        if (auto parsedWarmup = ParseNumberString(warmupString))
+        {
+            runOptions.WarmupInSeconds = parsedWarmup.value();
+        }
+        else
+        {
+            wprintf(L"Invalid warmup specified!\n");
+            return std::nullopt;
+        }
+    }
+    if (!minFpsString.empty())
+    {
+        auto parsedMinFps = ParseDoubleString(minFpsString);
+        if (parsedMinFps.has_value() && parsedMinFps.value() >= 0.0)
+        {
+            runOptions.MinimumFramesPerSecond = parsedMinFps;
+        }
+        else
+        {
+            wprintf(L"Invalid minimum fps specified!\n");
+            return std::nullopt;
+        }
+    }
+
+    std::optional<uint32_t> startupIterations;
+    if (!startupIterationsString.empty())
+    {
+        auto parsedIterations = ParseNumberString(startupIterationsString);
+        if (parsedIterations.has_value() && parsedIterations.value() > 0)
+        {
+            startupIterations = parsedIterations;
+        }
+        else
+        {
+            wprintf(L"Invalid startup iterations specified!\n");
+            return std::nullopt;
+        }
+    }
+
+    std::optional<SoakOptions> soakOptions;
+    if (soak)
+    {
+        soakOptions = SoakOptions{};
+        soakOptions->DurationInSeconds = runOptions.DurationInSeconds;
+        if (!sampleIntervalString.empty())
+        {
+            auto parsedInterval = ParseNumberString(sampleIntervalString);
+            if (parsedInterval.has_value() && parsedInterval.value() > 0)
+            {
+                soakOptions->SampleIntervalInSeconds = parsedInterval.value();
+            }
+            else
+            {
+                wprintf(L"Invalid sample interval specified!\n");
+                return std::nullopt;
+            }
+        }
+        if (!recycleString.empty())
+        {
+            auto parsedRecycle = ParseNumberString(recycleString);
+            if (parsedRecycle.has_value() && parsedRecycle.value() > 0)
+            {
+                soakOptions->RecycleIntervalInMinutes = parsedRecycle;
+            }
+            else
+            {
+                wprintf(L"Invalid recycle interval specified!\n");
+                return std::nullopt;
+            }
+        }
+    }
+    else if (!sampleIntervalString.empty() || !recycleString.empty())
+    {
+        wprintf(L"Ignoring 'sampleInterval' and 'recycle', they are only used with 'soak'.\n");
+    }
+
+    std::optional<ContentOptions> contentOptions;
+    if (generateContent)
+    {
+        contentOptions = ContentOptions{};
+        if (!contentFpsString.empty())
+        {
+            auto parsedFps = ParseNumberString(contentFpsString);
+            if (parsedFps.has_value() && parsedFps.value() > 0)
+            {
+                contentOptions->FramesPerSecond = parsedFps.value();
+            }
+            else
+            {
+                wprintf(L"Invalid content fps specified!\n");
+                return std::nullopt;
+            }
+        }
+        if (!contentSizeString.empty())
+        {
+            auto parsedSize = ParseSizeString(contentSizeString);
+            if (!parsedSize.has_value())
+            {
+                wprintf(L"Invalid content size specified!\n");
+                return std::nullopt;
+            }
+            contentOptions->Size = parsedSize.value();
+        }
+    }
+    else if (!contentFpsString.empty() || !contentSizeString.empty())
+    {
+        wprintf(L"Ignoring 'contentFps' and 'contentSize', they are only used with 'generateContent'.\n");
+    }
+
+    std::optional<uint32_t> windowIndex;
+    if (!windowIndexString.empty())
+    {
+        windowIndex = ParseNumberString(windowIndexString);
+        if (!windowIndex.has_value())
+        {
+            wprintf(L"Invalid window index specified!\n");
+            return std::nullopt;
+        }
+    }
+    std::optional<DWORD> processId;
+    if (!pidString.empty())
+    {
+        processId = ParseNumberString(pidString);
+        if (!processId.has_value())
+        {
+            wprintf(L"Invalid process id specified!\n");
+            return std::nullopt;
+        }
+    }
+
+    std::vector<CaptureSubject> subjects;
+    if (allMonitors && !monitorStrings.empty())
+    {
+        wprintf(L"Cannot use options 'monitor' and 'allMonitors' at the same time!\n");
+        return std::nullopt;
+    }
+    for (auto&& monitorString : monitorStrings)
+    {
+        if (auto parsedIndex = ParseNumberString(monitorString))
+        {
+            subjects.push_back(CaptureSubject(MonitorCaptureSubject{ parsedIndex.value() }));
+        }
+        else
+        {
+            wprintf(L"Invalid monitor index specified!\n");
+            return std::nullopt;
+        }
+    }
+    for (auto&& hwndString : hwndStrings)
+    {
+        if (auto windowHandle = ParseWindowHandleString(hwndString))
+        {
+            subjects.push_back(CaptureSubject(WindowHandleCaptureSubject{ windowHandle.value() }));
+        }
+        else
+        {
+            wprintf(L"Invalid window handle specified!\n");
+            return std::nullopt;
+        }
+    }
+    if (windowStrings.empty() && processId.has_value())
+    {
+        // Search every window owned by the process
+        windowStrings.push_back(L"");
+    }
+    for (auto&& windowString : windowStrings)
+    {
+        subjects.push_back(CaptureSubject(WindowCaptureSubject{ windowString, windowIndex, processId }));
+    }
+    if (subjects.empty() && !generateContent && !allMonitors)
+    {
+        subjects.push_back(CaptureSubject(MonitorCaptureSubject{ 0 }));
+    }
+
+    if (noBorder && !winrt::ApiInformation::IsPropertyPresent(winrt::name_of<winrt::GraphicsCaptureSession>(), L"IsBorderRequired"))
+    {
+        wprintf(L"Ignoring 'noBorder', this build of Windows does not support the feature.\n");
+        noBorder = false;
+    }
+    if (abBorder && !winrt::ApiInformation::IsPropertyPresent(winrt::name_of<winrt::GraphicsCaptureSession>(), L"IsBorderRequired"))
+    {
+        wprintf(L"The border can't be turned off on this build of Windows!\n");
+        return std::nullopt;
+    }
+    if ((minUpdateInterval || compareThrottling) && !winrt::ApiInformation::IsPropertyPresent(winrt::name_of<winrt::GraphicsCaptureSession>(), L"MinUpdateInterval"))
+    {
+        wprintf(L"MinUpdateInterval is not supported on this build of Windows!\n");
+        return std::nullopt;
+    }
+    if (dirtyRegions && !winrt::ApiInformation::IsPropertyPresent(winrt::name_of<winrt::GraphicsCaptureSession>(), L"DirtyRegionMode"))
+    {
+        wprintf(L"Ignoring 'dirtyRegions', this build of Windows does not support the feature.\n");
+        dirtyRegions = false;
+    }
+
+    CaptureConfig config = {};
+    config.IntervalInMs = intervals.front();
+    config.BufferCount = bufferCount;
+    config.PixelFormat = pixelFormat;
+    config.AdapterIndex = adapterIndex;
+    config.NoBorder = noBorder;
+    config.CursorCapture = cursor;
+    config.RecreateOnResize = !noRecreate;
+    config.DirtyRegions = dirtyRegions;
+    config.Throttle = minUpdateInterval ? ThrottleMode::MinUpdateInterval : ThrottleMode::Starvation;
+    config.FreeThreaded = freeThreaded;
+    config.Scheduler = scheduler;
+    config.Workload = workload;
+    config.WorkerCount = workerCount;
+    config.QueueDepth = queueDepth;
+    config.EncodeOutputPath = encodeOutputPath;
+    config.Pipeline = pipelineOptions;
+    config.GeneratedContent = generateContent;
+
+    std::vector<LabeledCaptureConfig> configs = { { L"", config } };
+    if (sweep)
+    {
+        std::vector<ConfigVariant> bufferVariants;
+        for (uint32_t count = 1; count <= bufferCount; count++)
+        {
+            bufferVariants.push_back({ std::to_wstring(count) + L" buf", [count](auto& config) { config.BufferCount = count; } });
+        }
+        configs = ExpandConfigs(configs, bufferVariants);
+
+        std::vector<ConfigVariant> intervalVariants;
+        for (auto&& interval : intervals)
+        {
+            intervalVariants.push_back({ std::to_wstring(interval) + L" ms", [interval](auto& config) { config.IntervalInMs = interval; } });
+        }
+        configs = ExpandConfigs(configs, intervalVariants);
+    }
+    if (compareThreading)
+    {
+        configs = ExpandConfigs(configs,
+            {
+                { L"dispatcher", [](auto& config) { config.FreeThreaded = false; } },
+                { L"free-threaded", [](auto& config) { config.FreeThreaded = true; } },
+            });
+    }
+    if (compareAdapters)
+    {
+        std::vector<ConfigVariant> adapterVariants;
+        for (auto&& adapter : adapters)
+        {
+            if (adapter.Software)
+            {
+                continue;
+            }
+            auto index = adapter.Index;
+            adapterVariants.push_back({ adapter.Description, [index](auto& config) { config.AdapterIndex = index; } });
+        }
+        configs = ExpandConfigs(configs, adapterVariants);
+    }
+    if (compareFormats)
+    {
+        std::vector<ConfigVariant> formatVariants;
+        for (auto&& format : { winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized, winrt::DirectXPixelFormat::R16G16B16A16Float })
+        {
+            formatVariants.push_back({ GetPixelFormatName(format), [format](auto& config) { config.PixelFormat = format; } });
+        }
+        configs = ExpandConfigs(configs, formatVariants);
+    }
+    if (compareThrottling)
+    {
+        configs = ExpandConfigs(configs,
+            {
+                { L"starvation", [](auto& config) { config.Throttle = ThrottleMode::Starvation; } },
+                { L"min update interval", [](auto& config) { config.Throttle = ThrottleMode::MinUpdateInterval; } },
+            });
+    }
+
+    std::optional<MatrixOptions> matrixOptions;
+    if (sweep || compareThreading || compareThrottling || compareFormats || compareAdapters)
+    {
+        matrixOptions = MatrixOptions{ configs, sweepDuration };
+    }
+
+    std::optional<AbTestPlan> abTestPlan;
+    if (abCursor || abBorder)
+    {
+        abTestPlan = AbTestPlan{ { { L"", config } }, {} };
+        // The first configuration is the baseline
+        if (abCursor)
+        {
+            abTestPlan->Configs = ExpandConfigs(abTestPlan->Configs,
+                {
+                    { L"cursor off", [](auto& config) { config.CursorCapture = false; } },
+                    { L"cursor on", [](auto& config) { config.CursorCapture = true; } },
+                });
+        }
+        if (abBorder)
+        {
+            abTestPlan->Configs = ExpandConfigs(abTestPlan->Configs,
+                {
+                    { L"border on", [](auto& config) { config.NoBorder = false; } },
+                    { L"border off", [](auto& config) { config.NoBorder = true; } },
+                });
+        }
+        if (!abWindowString.empty())
+        {
+            auto parsedWindow = ParseNumberString(abWindowString);
+            if (!parsedWindow.has_value() || parsedWindow.value() == 0)
+            {
+                wprintf(L"Invalid A/B window specified!\n");
+                return std::nullopt;
+            }
+            abTestPlan->Test.WindowInSeconds = parsedWindow.value();
+        }
+        if (!abRoundsString.empty())
+        {
+            // The t-test needs at least two samples per configuration
+            auto parsedRounds = ParseNumberString(abRoundsString);
+            if (!parsedRounds.has_value() || parsedRounds.value() < 2)
+            {
+                wprintf(L"Invalid A/B rounds specified, at least 2 are needed!\n");
+                return std::nullopt;
+            }
+            abTestPlan->Test.Rounds = parsedRounds.value();
+        }
+    }
+    else if (!abWindowString.empty() || !abRoundsString.empty())
+    {
+        wprintf(L"Ignoring 'abWindow' and 'abRounds', they are only used with 'abCursor' and 'abBorder'.\n");
+    }
+
+    std::optional<RampOptions> rampOptions;
+    if (ramp)
+    {
+        if (workerCount > 0)
+        {
+            wprintf(L"A 'ramp' releases held frames, it can't be used with 'workers'!\n");
+            return std::nullopt;
+        }
+        rampOptions = RampOptions{};
+        rampOptions->StartIntervalInMs = config.IntervalInMs;
+        if (!rampStepString.empty())
+        {
+            auto parsedStep = ParseNumberString(rampStepString);
+            if (!parsedStep.has_value() || parsedStep.value() == 0)
+            {
+                wprintf(L"Invalid ramp step specified!\n");
+                return std::nullopt;
+            }
+            rampOptions->StepInSeconds = parsedStep.value();
+        }
+    }
+    else if (!rampStepString.empty())
+    {
+        wprintf(L"Ignoring 'rampStep', it is only used with 'ramp'.\n");
+    }
+
+    if (static_cast<int>(matrixOptions.has_value()) + static_cast<int>(abTestPlan.has_value()) + static_cast<int>(startupIterations.has_value()) + static_cast<int>(soakOptions.has_value()) + static_cast<int>(rampOptions.has_value()) > 1)
+    {
+        wprintf(L"Comparison modes, A/B tests, 'startupIterations', 'soak' and 'ramp' can't be combined!\n");
+        return std::nullopt;
+    }
+
+    std::optional<BaselinePlan> baselinePlan;
+    if (!baselinePath.empty())
+    {
+        if (matrixOptions.has_value() || abTestPlan.has_value() || startupIterations.has_value() || soakOptions.has_value() || rampOptions.has_value())
+        {
+            wprintf(L"A 'baseline' can only be compared against a single run!\n");
+            return std::nullopt;
+        }
+        baselinePlan = BaselinePlan{ baselinePath, {} };
+        if (!thresholdString.empty())
+        {
+            auto parsedThreshold = ParseDoubleString(thresholdString);
+            if (!parsedThreshold.has_value() || parsedThreshold.value() < 0.0)
+            {
+                wprintf(L"Invalid threshold specified!\n");
+                return std::nullopt;
+            }
+            baselinePlan->Comparison.ThresholdPercent = parsedThreshold.value();
+        }
+    }
+    else if (!thresholdString.empty())
+    {
+        wprintf(L"Ignoring 'threshold', it is only used with 'baseline'.\n");
     }
 
     error = false;
-    return std::optional(Options{ subject, interval, noBorder });
+    return std::optional(Options{ subjects, config, runOptions, matrixOptions, abTestPlan, startupIterations, soakOptions, rampOptions, contentOptions, baselinePlan, outputPath, liveStatsName, watchName, allMonitors, etw, list });
 }
\ No newline at end of file
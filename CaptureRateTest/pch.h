@@ -2,6 +2,11 @@
 
 // Windows
 #include <windows.h>
+#include <dwmapi.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#include <pdh.h>
+#include <pdhmsg.h>
 
 // Must come before C++/WinRT
 #include <wil/cppwinrt.h>
@@ -28,6 +33,13 @@
 #include <dxgi1_6.h>
 #include <d2d1_3.h>
 #include <wincodec.h>
+#include <d3dcompiler.h>
+
+// Media Foundation
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <mferror.h>
 
 // STL
 #include <vector>
@@ -36,8 +48,17 @@
 #include <memory>
 #include <algorithm>
 #include <mutex>
+#include <condition_variable>
 #include <variant>
+#include <optional>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
 
 // robmikh.common
 #include <robmikh.common/composition.interop.h>